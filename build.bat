@@ -4,7 +4,7 @@ if NOT "%Platform%" == "X64" IF NOT "%Platform%" == "x64" (call vcvarsall x64)
 
 set exe_name=SpankTheFox
 set compile_flags= -nologo /Zi /FC /I ../include/ /W3
-set linker_flags= raylibdll.lib /INCREMENTAL:NO
+set linker_flags= raylibdll.lib user32.lib opengl32.lib /INCREMENTAL:NO
 set linker_path="../bin/"
 
 
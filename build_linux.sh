@@ -0,0 +1,21 @@
+#!/bin/sh
+# Builds the game on Linux against raylib 4.2 installed in the system.
+# Pass "release" to build with optimizations.
+
+set -e
+
+exe_name=SpankTheFox
+compile_flags="-std=c++11 -Wall -g"
+linker_flags="-lraylib -lGL -lm -lpthread -ldl -lrt -lX11"
+
+if [ "$1" = "release" ]; then
+    echo "BUILDING RELEASE!"
+    compile_flags="$compile_flags -O2"
+fi
+
+mkdir -p build
+cd build
+
+c++ $compile_flags ../src/main.cpp -o $exe_name $linker_flags
+
+cp -r ../assets .
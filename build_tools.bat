@@ -0,0 +1,16 @@
+@echo off
+
+if NOT "%Platform%" == "X64" IF NOT "%Platform%" == "x64" (call vcvarsall x64)
+
+set compile_flags= -nologo /O2 /FC /W3
+
+if not exist build mkdir build
+pushd build
+
+call cl %compile_flags% ../src/headless.cpp /Fe:headless.exe
+call cl %compile_flags% /EHsc ../src/bench_math.cpp /Fe:bench_math.exe
+call cl %compile_flags% ../src/mesh_optimizer.cpp /Fe:mesh_optimizer.exe
+call cl %compile_flags% /EHsc ../src/audio_transcoder.cpp /Fe:audio_transcoder.exe
+call cl %compile_flags% /EHsc ../src/checks.cpp /Fe:checks.exe
+
+popd
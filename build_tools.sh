@@ -0,0 +1,28 @@
+#!/bin/sh
+# Builds the tools that don't need a window or an audio device:
+#   headless         - game simulation without rendering, for tuning hit speeds
+#   bench_math       - micro-benchmarks of the per frame math
+#   mesh_optimizer   - rebuilds MagicaVoxel exports with merged faces and indices
+#   audio_transcoder - transcodes WAV clips to QOA, which the game streams
+#   checks           - checks of the render queue order and other engine parts
+#   checks_tsan      - the same checks with ThreadSanitizer, for the thread queues
+#   checks_asan      - the same checks with AddressSanitizer and UBSan, for the mixer
+
+set -e
+
+compile_flags="-std=c++11 -Wall -O2"
+
+mkdir -p build
+cd build
+
+c++ $compile_flags ../src/headless.cpp -o headless -lm
+c++ $compile_flags ../src/bench_math.cpp -o bench_math -lm
+c++ $compile_flags ../src/mesh_optimizer.cpp -o mesh_optimizer -lm
+c++ $compile_flags ../src/audio_transcoder.cpp -o audio_transcoder -lm
+c++ $compile_flags ../src/checks.cpp -o checks -lm -lpthread
+
+# Not every compiler has the sanitizers, the rest is built without them
+c++ -std=c++11 -Wall -O1 -g -fsanitize=thread ../src/checks.cpp -o checks_tsan -lm -lpthread ||
+    echo "checks_tsan isn't built, no ThreadSanitizer"
+c++ -std=c++11 -Wall -O1 -g -fsanitize=address,undefined ../src/checks.cpp -o checks_asan -lm -lpthread ||
+    echo "checks_asan isn't built, no AddressSanitizer"
@@ -0,0 +1,798 @@
+// Software mixer. Hits and screams are mixed by us into one raylib audio
+// stream, in its callback, instead of being separate Sounds mixed by
+// miniaudio. Music stays a raylib Music, raylib decodes it right into
+// its own stream, and there's no way to get the frames out of it.
+//
+// Voices belong to the audio thread. The main thread only sends commands
+// through a single producer / single consumer queue, like the other
+// queues, and the callback applies them before it mixes. So nothing the
+// game does takes the audio lock or waits for the audio thread.
+//
+// Gain, pan and pitch of a command are targets. The voice moves to them
+// over mixerRampTime, gain and pan every sample, pitch every chunk, so
+// values set once per game frame don't step audibly at any frame rate.
+//
+// Voices are a fixed pool, a sound gets any free one and a handle to
+// it. Handles carry the generation of the voice, so one that outlived
+// its sound does nothing. When all voices are busy, the one with the
+// lowest priority, playing the longest, is taken over, if it's not more
+// important than the new sound. Clips streamed from disk get a streaming
+// voice of the mixer's own pool the same way.
+//
+// A sound that's taken over or stopped doesn't end abruptly, which would
+// click. Its next mixerFadeFrames are rendered fading to silence when
+// that happens, and mixed in over the following chunks, whatever the
+// voice plays next.
+//
+// Every voice is resampled with linear interpolation, which also does the
+// pitch, and accumulated into the mix. Both are done with SSE, NEON or
+// wasm SIMD, whichever is there, or plain loops.
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#define MIXER_NEON 1
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define MIXER_WASM_SIMD 1
+#include <wasm_simd128.h>
+#endif
+
+#include "include/raylib.h"
+
+const int mixerVoiceCount = 16;
+const int mixerStreamCount = 4;
+// Voices are mixed this many frames at a time
+const int mixerChunkFrames = 256;
+// Source frames per output frame, pitch higher than that is clamped
+const int mixerMaxStep = 4;
+// Two frames of history and what a chunk reads at the highest step
+const int mixerSourceFrames = 2 + mixerChunkFrames * mixerMaxStep + 1;
+// Must be power of two
+const unsigned int mixerCommandQueueSize = 256;
+// Parameter changes are spread over this, in seconds
+const float mixerRampTime = 0.02f;
+// Sounds cut off fade out over this many frames, about 6 ms
+const int mixerFadeFrames = 256;
+static_assert(mixerFadeFrames <= mixerChunkFrames, "Fade is rendered as one chunk");
+
+// Clip decoded into memory, stereo float
+struct MixerSample {
+    float* frames;
+    int frameCount;
+    int sampleRate;
+};
+
+enum MixerCommandType {
+    MIXER_PLAY,
+    MIXER_STOP,
+    MIXER_SET_GAIN,
+    MIXER_SET_PITCH,
+    MIXER_SET_PAN,
+};
+
+// Generation 0 is never played, a zeroed handle is no sound
+struct MixerHandle {
+    int voice;
+    unsigned int generation;
+};
+
+struct MixerCommand {
+    MixerCommandType type;
+    int voice;
+    unsigned int generation;
+
+    // Source of a played voice, a sample or a stream
+    const MixerSample* sample;
+    StreamingVoice* stream;
+    int sampleRate;
+
+    float gain;
+    float pitch;
+    // -1 left, 1 right
+    float pan;
+};
+
+struct MixerVoice {
+    bool playing;
+    unsigned int generation;
+
+    const MixerSample* sample;
+    StreamingVoice* stream;
+    int sampleRate;
+    // Next frame of the sample
+    int cursor;
+
+    // Targets, from the commands
+    float gain;
+    float pitch;
+    float pan;
+
+    // Values the voice has now, left and right gain
+    // with the pan applied, moving to the targets
+    float channelGains[2];
+    float currentPitch;
+    int rampLeft;
+
+    // Source is read in order, these are the two frames the
+    // position is in between, the position is from the first one
+    float history[4];
+    double position;
+
+    // Fade out of the sound this voice played before, still being mixed
+    float fade[mixerFadeFrames * 2];
+    int fadeFrames;
+    int fadeCursor;
+};
+
+// What the main thread knows about a voice
+struct MixerVoiceState {
+    unsigned int generation;
+    int priority;
+    // Older sounds are taken over first
+    long long playOrder;
+};
+
+struct AudioMixer {
+    AudioStream stream;
+    int sampleRate;
+    int rampFrames;
+
+    SpscQueue<MixerCommand, mixerCommandQueueSize> commands;
+
+    // Main thread
+    MixerVoiceState voiceStates[mixerVoiceCount];
+    unsigned int nextGeneration;
+    long long playCount;
+    // Commands that didn't fit into the queue
+    int droppedCommands;
+
+    // Generation each voice played last when it ended, a voice
+    // is free when it's the one the main thread started last
+    std::atomic<unsigned int> endedGenerations[mixerVoiceCount];
+
+    // Streams of the played clips, filled by the main thread
+    StreamingVoice streams[mixerStreamCount];
+    MixerHandle streamHandles[mixerStreamCount];
+
+    // Everything below is the audio thread's
+    MixerVoice voices[mixerVoiceCount];
+
+    float source[mixerSourceFrames * 2];
+    float resampled[mixerChunkFrames * 2];
+    float mix[mixerChunkFrames * 2];
+};
+
+// raylib callbacks get no user pointer
+AudioMixer* audioMixer;
+
+// ================
+// Kernels
+// ================
+// Stereo frames at the positions, interpolated between the
+// source frames around them. Source has to have the frame
+// after the last position too
+void ResampleFrames(const float* source, double position, double step, float* output, int frames) {
+    int i = 0;
+
+#if MIXER_SSE || MIXER_NEON || MIXER_WASM_SIMD
+    // Two output frames at a time, each reads its two source frames
+    // with one load, the first ones go to a, the second ones to b
+    for(; i + 2 <= frames; i += 2) {
+        double p0 = position + i * step;
+        double p1 = p0 + step;
+        int i0 = (int) p0;
+        int i1 = (int) p1;
+        float f0 = (float) (p0 - i0);
+        float f1 = (float) (p1 - i1);
+
+#if MIXER_SSE
+        __m128 x = _mm_loadu_ps(source + i0 * 2);
+        __m128 y = _mm_loadu_ps(source + i1 * 2);
+        __m128 a = _mm_movelh_ps(x, y);
+        __m128 b = _mm_movehl_ps(y, x);
+        __m128 f = _mm_set_ps(f1, f1, f0, f0);
+        _mm_storeu_ps(output + i * 2, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), f)));
+#elif MIXER_NEON
+        float32x4_t x = vld1q_f32(source + i0 * 2);
+        float32x4_t y = vld1q_f32(source + i1 * 2);
+        float32x4_t a = vcombine_f32(vget_low_f32(x), vget_low_f32(y));
+        float32x4_t b = vcombine_f32(vget_high_f32(x), vget_high_f32(y));
+        float32x4_t f = vcombine_f32(vdup_n_f32(f0), vdup_n_f32(f1));
+        vst1q_f32(output + i * 2, vmlaq_f32(a, vsubq_f32(b, a), f));
+#else
+        v128_t x = wasm_v128_load(source + i0 * 2);
+        v128_t y = wasm_v128_load(source + i1 * 2);
+        v128_t a = wasm_i32x4_shuffle(x, y, 0, 1, 4, 5);
+        v128_t b = wasm_i32x4_shuffle(x, y, 2, 3, 6, 7);
+        v128_t f = wasm_f32x4_make(f0, f0, f1, f1);
+        wasm_v128_store(output + i * 2, wasm_f32x4_add(a, wasm_f32x4_mul(wasm_f32x4_sub(b, a), f)));
+#endif
+    }
+#endif
+
+    for(; i < frames; i++) {
+        double p = position + i * step;
+        int index = (int) p;
+        float f = (float) (p - index);
+
+        const float* a = source + index * 2;
+        output[i * 2 + 0] = a[0] + (a[2] - a[0]) * f;
+        output[i * 2 + 1] = a[1] + (a[3] - a[1]) * f;
+    }
+}
+
+// Adds stereo frames to the mix with a gain per channel, which
+// changes by the step every frame
+void AccumulateFrames(float* mix, const float* input, float left, float right,
+                      float leftStep, float rightStep, int frames) {
+    int samples = frames * 2;
+    int i = 0;
+
+    // Two frames at a time, so gains go two steps further every time
+#if MIXER_SSE
+    __m128 gain = _mm_set_ps(right + rightStep, left + leftStep, right, left);
+    __m128 step = _mm_set_ps(2 * rightStep, 2 * leftStep, 2 * rightStep, 2 * leftStep);
+    for(; i + 4 <= samples; i += 4) {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(_mm_loadu_ps(input + i), gain));
+        _mm_storeu_ps(mix + i, sum);
+        gain = _mm_add_ps(gain, step);
+    }
+#elif MIXER_NEON
+    float gains[4] = { left, right, left + leftStep, right + rightStep };
+    float steps[4] = { 2 * leftStep, 2 * rightStep, 2 * leftStep, 2 * rightStep };
+    float32x4_t gain = vld1q_f32(gains);
+    float32x4_t step = vld1q_f32(steps);
+    for(; i + 4 <= samples; i += 4) {
+        vst1q_f32(mix + i, vmlaq_f32(vld1q_f32(mix + i), vld1q_f32(input + i), gain));
+        gain = vaddq_f32(gain, step);
+    }
+#elif MIXER_WASM_SIMD
+    v128_t gain = wasm_f32x4_make(left, right, left + leftStep, right + rightStep);
+    v128_t step = wasm_f32x4_make(2 * leftStep, 2 * rightStep, 2 * leftStep, 2 * rightStep);
+    for(; i + 4 <= samples; i += 4) {
+        v128_t sum = wasm_f32x4_add(wasm_v128_load(mix + i), wasm_f32x4_mul(wasm_v128_load(input + i), gain));
+        wasm_v128_store(mix + i, sum);
+        gain = wasm_f32x4_add(gain, step);
+    }
+#endif
+
+    for(; i < samples; i += 2) {
+        float frame = (float) (i / 2);
+        mix[i + 0] += input[i + 0] * (left + leftStep * frame);
+        mix[i + 1] += input[i + 1] * (right + rightStep * frame);
+    }
+}
+
+// Clamps the mix into the output, loud overlapping voices clip
+void WriteMixOutput(float* output, const float* mix, int samples) {
+    int i = 0;
+
+#if MIXER_SSE
+    __m128 low = _mm_set1_ps(-1.0f);
+    __m128 high = _mm_set1_ps(1.0f);
+    for(; i + 4 <= samples; i += 4) {
+        _mm_storeu_ps(output + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + i), low), high));
+    }
+#elif MIXER_NEON
+    float32x4_t low = vdupq_n_f32(-1.0f);
+    float32x4_t high = vdupq_n_f32(1.0f);
+    for(; i + 4 <= samples; i += 4) {
+        vst1q_f32(output + i, vminq_f32(vmaxq_f32(vld1q_f32(mix + i), low), high));
+    }
+#elif MIXER_WASM_SIMD
+    v128_t low = wasm_f32x4_splat(-1.0f);
+    v128_t high = wasm_f32x4_splat(1.0f);
+    for(; i + 4 <= samples; i += 4) {
+        wasm_v128_store(output + i, wasm_f32x4_min(wasm_f32x4_max(wasm_v128_load(mix + i), low), high));
+    }
+#endif
+
+    for(; i < samples; i++) {
+        output[i] = mix[i] < -1.0f ? -1.0f : (mix[i] > 1.0f ? 1.0f : mix[i]);
+    }
+}
+
+// ================
+// Audio thread
+// ================
+// Reads the next frames of the voice's source, silence past its end.
+// Returns the number of frames there were, ended is set at the end
+int ReadMixerSource(MixerVoice* voice, float* dest, int frames, bool* ended) {
+    int count = 0;
+
+    if(voice->sample) {
+        int left = voice->sample->frameCount - voice->cursor;
+        count = frames < left ? frames : left;
+
+        memcpy(dest, voice->sample->frames + voice->cursor * 2, count * 2 * sizeof(float));
+        voice->cursor += count;
+        *ended = count < frames;
+    }
+    else {
+        count = ReadStreamingVoice(voice->stream, dest, frames, ended);
+    }
+
+    memset(dest + count * 2, 0, (frames - count) * 2 * sizeof(float));
+    return count;
+}
+
+// Balance, the side it's panned to stays at full gain
+void GetMixerChannelGains(const MixerVoice* voice, float* gains) {
+    gains[0] = voice->gain * (voice->pan > 0 ? 1 - voice->pan : 1);
+    gains[1] = voice->gain * (voice->pan < 0 ? 1 + voice->pan : 1);
+}
+
+// Reads the next frames of the source like ReadMixerSource, but leaves
+// the voice as it is. Sample of the voice is read from its copy
+int PeekMixerSource(const MixerVoice* voice, float* dest, int frames) {
+    int count = 0;
+
+    if(voice->sample) {
+        int left = voice->sample->frameCount - voice->cursor;
+        count = frames < left ? frames : left;
+        memcpy(dest, voice->sample->frames + voice->cursor * 2, count * 2 * sizeof(float));
+    }
+    else {
+        count = PeekStreamingVoice(voice->stream, dest, frames);
+    }
+
+    memset(dest + count * 2, 0, (frames - count) * 2 * sizeof(float));
+    return count;
+}
+
+// Renders how the playing sound would go on, fading to silence, before
+// the voice is taken over or stopped. What's left of an earlier fade
+// is kept under it
+void FadeOutMixerVoice(AudioMixer* mixer, MixerVoice* voice) {
+    int left = voice->fadeFrames - voice->fadeCursor;
+    memmove(voice->fade, voice->fade + voice->fadeCursor * 2, left * 2 * sizeof(float));
+    memset(voice->fade + left * 2, 0, (mixerFadeFrames - left) * 2 * sizeof(float));
+
+    voice->fadeFrames = mixerFadeFrames;
+    voice->fadeCursor = 0;
+
+    double step = (double) voice->currentPitch * voice->sampleRate / mixer->sampleRate;
+    step = step < 0 ? 0 : (step > mixerMaxStep ? mixerMaxStep : step);
+    int whole = (int) (voice->position + mixerFadeFrames * step);
+
+    float* source = mixer->source;
+    memcpy(source, voice->history, sizeof(voice->history));
+    PeekMixerSource(voice, source + 4, whole);
+
+    ResampleFrames(source, voice->position, step, mixer->resampled, mixerFadeFrames);
+
+    float* gains = voice->channelGains;
+    AccumulateFrames(voice->fade, mixer->resampled, gains[0], gains[1],
+                     -gains[0] / mixerFadeFrames, -gains[1] / mixerFadeFrames, mixerFadeFrames);
+}
+
+void EndMixerVoice(AudioMixer* mixer, int index) {
+    MixerVoice* voice = &mixer->voices[index];
+    voice->playing = false;
+    mixer->endedGenerations[index].store(voice->generation, std::memory_order_release);
+}
+
+void ApplyMixerCommands(AudioMixer* mixer) {
+    MixerCommand* command;
+    while((command = PeekQueue(&mixer->commands)) != NULL) {
+        MixerVoice* voice = &mixer->voices[command->voice];
+
+        // Sound of the command is over already, or the voice was taken over
+        if(command->type != MIXER_PLAY && (voice->playing == false || voice->generation != command->generation)) {
+            PopQueue(&mixer->commands);
+            continue;
+        }
+
+        switch(command->type) {
+        case MIXER_PLAY: {
+            // Sound the voice played before doesn't end, the main
+            // thread forgot about it when it took the voice over
+            if(voice->playing) {
+                FadeOutMixerVoice(mixer, voice);
+            }
+
+            voice->generation = command->generation;
+            voice->sample = command->sample;
+            voice->stream = command->stream;
+            voice->sampleRate = command->sampleRate;
+            voice->cursor = 0;
+            voice->gain = command->gain;
+            voice->pitch = command->pitch;
+            voice->pan = command->pan;
+            voice->position = 0;
+
+            // Starts right at the targets, a ramp would soften the attack
+            GetMixerChannelGains(voice, voice->channelGains);
+            voice->currentPitch = voice->pitch;
+            voice->rampLeft = 0;
+
+            // Old clip of the stream was faded out above
+            if(voice->stream) {
+                RestartStreamingVoice(voice->stream);
+            }
+
+            bool ended;
+            ReadMixerSource(voice, voice->history, 2, &ended);
+            voice->playing = true;
+            break;
+        }
+        case MIXER_STOP:
+            FadeOutMixerVoice(mixer, voice);
+            EndMixerVoice(mixer, command->voice);
+            break;
+        case MIXER_SET_GAIN:
+            voice->gain = command->gain;
+            voice->rampLeft = mixer->rampFrames;
+            break;
+        case MIXER_SET_PITCH:
+            voice->pitch = command->pitch;
+            voice->rampLeft = mixer->rampFrames;
+            break;
+        case MIXER_SET_PAN:
+            voice->pan = command->pan;
+            voice->rampLeft = mixer->rampFrames;
+            break;
+        }
+
+        PopQueue(&mixer->commands);
+    }
+}
+
+void MixVoice(AudioMixer* mixer, int index, int frames) {
+    MixerVoice* voice = &mixer->voices[index];
+
+    double step = (double) voice->currentPitch * voice->sampleRate / mixer->sampleRate;
+    step = step < 0 ? 0 : (step > mixerMaxStep ? mixerMaxStep : step);
+
+    // Frames up to the one after the end position, history is before them
+    double end = voice->position + frames * step;
+    int whole = (int) end;
+
+    float* source = mixer->source;
+    memcpy(source, voice->history, sizeof(voice->history));
+
+    bool ended;
+    int read = ReadMixerSource(voice, source + 4, whole, &ended);
+
+    ResampleFrames(source, voice->position, step, mixer->resampled, frames);
+
+    // Ramped part first, it ends right at the targets. A new
+    // target restarts the ramp from wherever the voice is
+    float targets[2];
+    GetMixerChannelGains(voice, targets);
+    float* gains = voice->channelGains;
+
+    int ramped = frames < voice->rampLeft ? frames : voice->rampLeft;
+    if(ramped > 0) {
+        float leftStep = (targets[0] - gains[0]) / voice->rampLeft;
+        float rightStep = (targets[1] - gains[1]) / voice->rampLeft;
+        AccumulateFrames(mixer->mix, mixer->resampled, gains[0], gains[1], leftStep, rightStep, ramped);
+
+        voice->currentPitch += (voice->pitch - voice->currentPitch) * ramped / voice->rampLeft;
+        voice->rampLeft -= ramped;
+
+        if(voice->rampLeft == 0) {
+            gains[0] = targets[0];
+            gains[1] = targets[1];
+            voice->currentPitch = voice->pitch;
+        }
+        else {
+            gains[0] += leftStep * ramped;
+            gains[1] += rightStep * ramped;
+        }
+    }
+
+    AccumulateFrames(mixer->mix + ramped * 2, mixer->resampled + ramped * 2, gains[0], gains[1], 0, 0, frames - ramped);
+
+    memcpy(voice->history, source + whole * 2, sizeof(voice->history));
+    voice->position = end - whole;
+
+    // Last frames were played out with this chunk
+    if(ended && read == 0) {
+        EndMixerVoice(mixer, index);
+    }
+}
+
+void MixAudio(AudioMixer* mixer, float* output, int frames) {
+    ApplyMixerCommands(mixer);
+
+    while(frames > 0) {
+        int count = frames < mixerChunkFrames ? frames : mixerChunkFrames;
+        memset(mixer->mix, 0, count * 2 * sizeof(float));
+
+        for(int i = 0; i < mixerVoiceCount; i++) {
+            MixerVoice* voice = &mixer->voices[i];
+            if(voice->playing) {
+                MixVoice(mixer, i, count);
+            }
+
+            int fadeLeft = voice->fadeFrames - voice->fadeCursor;
+            if(fadeLeft > 0) {
+                int fadeCount = count < fadeLeft ? count : fadeLeft;
+                AccumulateFrames(mixer->mix, voice->fade + voice->fadeCursor * 2, 1, 1, 0, 0, fadeCount);
+                voice->fadeCursor += fadeCount;
+            }
+        }
+
+        WriteMixOutput(output, mixer->mix, count * 2);
+        output += count * 2;
+        frames -= count;
+    }
+}
+
+void AudioMixerCallback(void* buffer, unsigned int frames) {
+    MixAudio(audioMixer, (float*) buffer, (int) frames);
+}
+
+// ================
+// Main thread
+// ================
+// Audio device has to be initialized. There's only one mixer
+bool InitAudioMixer(AudioMixer* mixer, int sampleRate) {
+    mixer->sampleRate = sampleRate;
+    mixer->rampFrames = (int) (sampleRate * mixerRampTime);
+    mixer->nextGeneration = 1;
+    mixer->playCount = 0;
+    mixer->droppedCommands = 0;
+
+    for(int i = 0; i < mixerVoiceCount; i++) {
+        mixer->voiceStates[i] = {};
+        mixer->endedGenerations[i] = 0;
+        mixer->voices[i] = {};
+    }
+
+    for(int i = 0; i < mixerStreamCount; i++) {
+        InitStreamingVoice(&mixer->streams[i]);
+        mixer->streamHandles[i] = {};
+    }
+
+    audioMixer = mixer;
+
+    mixer->stream = LoadAudioStream(sampleRate, 32, 2);
+    if(mixer->stream.buffer == NULL) {
+        printf("Failed to create the mixer stream\n");
+        return false;
+    }
+
+    SetAudioStreamCallback(mixer->stream, AudioMixerCallback);
+    PlayAudioStream(mixer->stream);
+
+    return true;
+}
+
+void CloseAudioMixer(AudioMixer* mixer) {
+    UnloadAudioStream(mixer->stream);
+    audioMixer = NULL;
+}
+
+// Decodes the whole clip, converted to the given sample rate
+bool LoadMixerSample(MixerSample* sample, const char* path, int sampleRate) {
+    *sample = {};
+
+    Wave wave = LoadWave(path);
+    if(wave.data == NULL) {
+        printf("Failed to load %s\n", path);
+        return false;
+    }
+
+    WaveFormat(&wave, sampleRate, 32, 2);
+
+    sample->frames = (float*) wave.data;
+    sample->frameCount = (int) wave.frameCount;
+    sample->sampleRate = (int) wave.sampleRate;
+
+    return true;
+}
+
+// Mixer must not be playing the sample anymore
+void UnloadMixerSample(MixerSample* sample) {
+    Wave wave = {};
+    wave.data = sample->frames;
+    UnloadWave(wave);
+
+    *sample = {};
+}
+
+// Never waits, when the audio thread is that far behind, it's dropped
+bool PushMixerCommand(AudioMixer* mixer, const MixerCommand& command) {
+    MixerCommand* slot = BeginQueuePush(&mixer->commands);
+    if(slot == NULL) {
+        mixer->droppedCommands++;
+        return false;
+    }
+
+    *slot = command;
+    EndQueuePush(&mixer->commands);
+    return true;
+}
+
+bool IsMixerVoiceFree(AudioMixer* mixer, int voice) {
+    return mixer->endedGenerations[voice].load(std::memory_order_acquire) == mixer->voiceStates[voice].generation;
+}
+
+// False also when the sound was taken over by another one
+bool IsMixerSoundPlaying(AudioMixer* mixer, MixerHandle handle) {
+    return handle.generation != 0 && mixer->voiceStates[handle.voice].generation == handle.generation &&
+           IsMixerVoiceFree(mixer, handle.voice) == false;
+}
+
+// Whether the first voice is taken over sooner than the second
+bool IsMixerVoiceWeaker(AudioMixer* mixer, int voice, int other) {
+    MixerVoiceState* a = &mixer->voiceStates[voice];
+    MixerVoiceState* b = &mixer->voiceStates[other];
+    return a->priority < b->priority || (a->priority == b->priority && a->playOrder < b->playOrder);
+}
+
+// Free voice, or the one to take over. -1 when all
+// voices play something more important
+int PickMixerVoice(AudioMixer* mixer, int priority) {
+    int weakest = -1;
+
+    for(int i = 0; i < mixerVoiceCount; i++) {
+        if(IsMixerVoiceFree(mixer, i)) {
+            return i;
+        }
+
+        if(weakest < 0 || IsMixerVoiceWeaker(mixer, i, weakest)) {
+            weakest = i;
+        }
+    }
+
+    return mixer->voiceStates[weakest].priority <= priority ? weakest : -1;
+}
+
+// Starts the sound of the command on the voice
+MixerHandle StartMixerVoice(AudioMixer* mixer, int voice, int priority, MixerCommand* command) {
+    MixerVoiceState* state = &mixer->voiceStates[voice];
+    MixerVoiceState previous = *state;
+
+    state->generation = mixer->nextGeneration++;
+    if(mixer->nextGeneration == 0) {
+        mixer->nextGeneration = 1;
+    }
+    state->priority = priority;
+    state->playOrder = mixer->playCount++;
+
+    command->type = MIXER_PLAY;
+    command->voice = voice;
+    command->generation = state->generation;
+
+    if(PushMixerCommand(mixer, *command) == false) {
+        *state = previous;
+        return {};
+    }
+
+    MixerHandle handle = { voice, state->generation };
+    return handle;
+}
+
+// Returns zeroed handle when the sound isn't played
+MixerHandle PlayMixerSample(AudioMixer* mixer, const MixerSample* sample, int priority,
+                            float gain, float pitch, float pan) {
+    int voice = PickMixerVoice(mixer, priority);
+    if(voice < 0 || sample->frames == NULL) {
+        return {};
+    }
+
+    MixerCommand command = {};
+    command.sample = sample;
+    command.sampleRate = sample->sampleRate;
+    command.gain = gain;
+    command.pitch = pitch;
+    command.pan = pan;
+
+    return StartMixerVoice(mixer, voice, priority, &command);
+}
+
+// Streamed clip, on a free streaming voice, or one taken over
+// together with its voice. Returns zeroed handle when it isn't played
+MixerHandle PlayMixerClip(AudioMixer* mixer, StreamingClip* clip, int priority,
+                          float gain, float pitch, float pan) {
+    if(clip->file == NULL) {
+        return {};
+    }
+
+    int stream = -1;
+    for(int i = 0; i < mixerStreamCount; i++) {
+        if(IsMixerSoundPlaying(mixer, mixer->streamHandles[i]) == false) {
+            stream = i;
+            break;
+        }
+    }
+
+    int voice = -1;
+    if(stream >= 0) {
+        voice = PickMixerVoice(mixer, priority);
+    }
+    else {
+        for(int i = 0; i < mixerStreamCount; i++) {
+            if(stream < 0 || IsMixerVoiceWeaker(mixer, mixer->streamHandles[i].voice, mixer->streamHandles[stream].voice)) {
+                stream = i;
+            }
+        }
+
+        voice = mixer->streamHandles[stream].voice;
+        if(mixer->voiceStates[voice].priority > priority) {
+            voice = -1;
+        }
+    }
+
+    if(voice < 0) {
+        return {};
+    }
+
+    // Stream is restarted right away, so the play
+    // command can't be the one that doesn't fit
+    if(BeginQueuePush(&mixer->commands) == NULL) {
+        mixer->droppedCommands++;
+        return {};
+    }
+
+    StreamingVoice* streaming = &mixer->streams[stream];
+    PlayStreamingVoice(streaming, clip);
+
+    MixerCommand command = {};
+    command.stream = streaming;
+    command.sampleRate = clip->sampleRate;
+    command.gain = gain;
+    command.pitch = pitch;
+    command.pan = pan;
+
+    mixer->streamHandles[stream] = StartMixerVoice(mixer, voice, priority, &command);
+    return mixer->streamHandles[stream];
+}
+
+// Fills the streams of the playing clips, called every frame
+void UpdateAudioMixer(AudioMixer* mixer) {
+    for(int i = 0; i < mixerStreamCount; i++) {
+        if(IsMixerSoundPlaying(mixer, mixer->streamHandles[i])) {
+            UpdateStreamingVoice(&mixer->streams[i]);
+        }
+        else {
+            StopStreamingVoice(&mixer->streams[i]);
+        }
+    }
+}
+
+void SendMixerCommand(AudioMixer* mixer, MixerHandle handle, MixerCommand* command) {
+    if(IsMixerSoundPlaying(mixer, handle) == false) {
+        return;
+    }
+
+    command->voice = handle.voice;
+    command->generation = handle.generation;
+    PushMixerCommand(mixer, *command);
+}
+
+void StopMixerSound(AudioMixer* mixer, MixerHandle handle) {
+    MixerCommand command = {};
+    command.type = MIXER_STOP;
+    SendMixerCommand(mixer, handle, &command);
+}
+
+void SetMixerSoundGain(AudioMixer* mixer, MixerHandle handle, float gain) {
+    MixerCommand command = {};
+    command.type = MIXER_SET_GAIN;
+    command.gain = gain;
+    SendMixerCommand(mixer, handle, &command);
+}
+
+void SetMixerSoundPitch(AudioMixer* mixer, MixerHandle handle, float pitch) {
+    MixerCommand command = {};
+    command.type = MIXER_SET_PITCH;
+    command.pitch = pitch;
+    SendMixerCommand(mixer, handle, &command);
+}
+
+void SetMixerSoundPan(AudioMixer* mixer, MixerHandle handle, float pan) {
+    MixerCommand command = {};
+    command.type = MIXER_SET_PAN;
+    command.pan = pan;
+    SendMixerCommand(mixer, handle, &command);
+}
@@ -0,0 +1,523 @@
+// Transcodes WAV clips to QOA (qoa.h), which the game streams instead of
+// the WAVs. 16 and 24 bit PCM is accepted, 24 bit is rounded to 16 bit
+// first, QOA has 16 bit samples.
+//
+// For every clip it prints the size saved, the error of the lossy
+// encoding, and how long decoding takes compared to the WAV. Both are
+// decoded from memory, so it's the decoder alone, without the file read.
+//
+// Manifest has a line per clip with its sample rate, length and loudness
+// (peak and RMS in dBFS), so levels of the clips can be compared without
+// loading them.
+//
+// Usage: audio_transcoder [--out dir] [--manifest path] input.wav...
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qoa.h"
+
+const int maxPathLength = 512;
+const int decodeRuns = 20;
+
+// Interleaved 16 bit samples
+struct AudioClip {
+    short* samples;
+    int frameCount;
+    int channels;
+    int sampleRate;
+};
+
+struct ClipReport {
+    char name[maxPathLength];
+    int sourceSize;
+    int qoaSize;
+
+    double peakDb;
+    double rmsDb;
+    double snrDb;
+
+    // Best of the runs, seconds
+    double wavDecodeTime;
+    double qoaDecodeTime;
+};
+
+double Now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned char* ReadWholeFile(const char* path, int* size) {
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) {
+        printf("Failed to open %s\n", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *size = (int) ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char* data = (unsigned char*) malloc(*size);
+    if(fread(data, 1, *size, file) != (size_t) *size) {
+        printf("Failed to read %s\n", path);
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    return data;
+}
+
+unsigned int ReadLe(const unsigned char* data, int bytes) {
+    unsigned int value = 0;
+    for(int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// Decodes a WAV file in memory, samples are allocated into the clip
+bool DecodeWav(const unsigned char* data, int size, AudioClip* clip) {
+    if(size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    int format = 0;
+    int bits = 0;
+    int channels = 0;
+    const unsigned char* pcm = NULL;
+    unsigned int pcmSize = 0;
+
+    int offset = 12;
+    while(offset + 8 <= size && pcm == NULL) {
+        const unsigned char* chunk = data + offset;
+        unsigned int chunkSize = ReadLe(chunk + 4, 4);
+        offset += 8;
+
+        if(memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+            format = ReadLe(chunk + 8, 2);
+            channels = ReadLe(chunk + 10, 2);
+            clip->sampleRate = ReadLe(chunk + 12, 4);
+            bits = ReadLe(chunk + 22, 2);
+        }
+        else if(memcmp(chunk, "data", 4) == 0) {
+            pcm = chunk + 8;
+            pcmSize = chunkSize < (unsigned int) (size - offset) ? chunkSize : size - offset;
+        }
+
+        // Chunks are padded to even size
+        offset += chunkSize + (chunkSize & 1);
+    }
+
+    // PCM or WAVE_FORMAT_EXTENSIBLE
+    if(pcm == NULL || (format != 1 && format != 0xFFFE) || (bits != 16 && bits != 24) ||
+       channels < 1 || channels > qoaMaxChannels) {
+        return false;
+    }
+
+    int bytesPerSample = bits / 8;
+    int sampleCount = pcmSize / bytesPerSample;
+    sampleCount -= sampleCount % channels;
+
+    clip->channels = channels;
+    clip->frameCount = sampleCount / channels;
+    clip->samples = (short*) malloc(sampleCount * sizeof(short));
+
+    if(bits == 16) {
+        for(int i = 0; i < sampleCount; i++) {
+            clip->samples[i] = (short) ReadLe(pcm + i * 2, 2);
+        }
+    }
+    else {
+        for(int i = 0; i < sampleCount; i++) {
+            const unsigned char* sample = pcm + i * 3;
+            int value = (int) ((sample[0] << 8) | (sample[1] << 16) | (sample[2] << 24)) >> 8;
+
+            // Rounded, not truncated, that would add a DC offset
+            value = (value + 128) >> 8;
+            clip->samples[i] = (short) (value > 32767 ? 32767 : value);
+        }
+    }
+
+    return true;
+}
+
+// Residual divided by the scale factor, rounded away from zero
+int DivideQoaResidual(int value, int scaleFactor) {
+    int n = (int) (((long long) value * qoaReciprocals[scaleFactor] + (1 << 15)) >> 16);
+    return n + ((value > 0) - (value < 0)) - ((n > 0) - (n < 0));
+}
+
+// Encodes one frame, returns its size. Channels keep their LMS
+// state and last scale factor from frame to frame
+int EncodeQoaFrame(const AudioClip* clip, int first, int frameSamples,
+                   QoaLms* lms, int* lastScaleFactors, unsigned char* out) {
+    int channels = clip->channels;
+    int size = GetQoaFrameSize(channels, frameSamples);
+
+    WriteQoaU64(out, ((uint64_t) channels << 56) | ((uint64_t) clip->sampleRate << 32) |
+                     ((uint64_t) frameSamples << 16) | (uint64_t) size);
+    unsigned char* write = out + qoaFrameHeaderSize;
+
+    for(int c = 0; c < channels; c++) {
+        uint64_t history = 0;
+        uint64_t weights = 0;
+        for(int i = 0; i < qoaLmsLength; i++) {
+            history = (history << 16) | (lms[c].history[i] & 0xffff);
+            weights = (weights << 16) | (lms[c].weights[i] & 0xffff);
+        }
+
+        WriteQoaU64(write, history);
+        WriteQoaU64(write + 8, weights);
+        write += 16;
+    }
+
+    for(int start = 0; start < frameSamples; start += qoaSliceLength) {
+        int sliceLength = frameSamples - start < qoaSliceLength ? frameSamples - start : qoaSliceLength;
+
+        for(int c = 0; c < channels; c++) {
+            const short* samples = clip->samples + (first + start) * channels + c;
+
+            uint64_t bestRank = UINT64_MAX;
+            uint64_t bestSlice = 0;
+            QoaLms bestLms = lms[c];
+            int bestScaleFactor = 0;
+
+            // Every scale factor is tried, starting from the last
+            // one, so a good one is found early and the rest cut short
+            for(int i = 0; i < 16; i++) {
+                int scaleFactor = (i + lastScaleFactors[c]) % 16;
+
+                QoaLms current = lms[c];
+                uint64_t slice = scaleFactor;
+                uint64_t rank = 0;
+
+                for(int s = 0; s < sliceLength; s++) {
+                    int sample = samples[s * channels];
+                    int predicted = PredictQoaSample(&current);
+
+                    int scaled = DivideQoaResidual(sample - predicted, scaleFactor);
+                    int clamped = scaled < -8 ? -8 : (scaled > 8 ? 8 : scaled);
+                    int quantized = qoaQuantize[clamped + 8];
+                    int dequantized = qoaDequantize[scaleFactor][quantized];
+                    int reconstructed = ClampQoaSample(predicted + dequantized);
+
+                    // Large weights make the predictor blow up later on,
+                    // so they count as error too
+                    long long weights = 0;
+                    for(int w = 0; w < qoaLmsLength; w++) {
+                        weights += (long long) current.weights[w] * current.weights[w];
+                    }
+                    long long penalty = (weights >> 18) - 0x8ff;
+                    penalty = penalty > 0 ? penalty : 0;
+
+                    long long error = sample - reconstructed;
+                    rank += error * error + penalty * penalty;
+                    if(rank > bestRank) {
+                        break;
+                    }
+
+                    UpdateQoaLms(&current, reconstructed, dequantized);
+                    slice = (slice << 3) | quantized;
+                }
+
+                if(rank < bestRank) {
+                    bestRank = rank;
+                    bestSlice = slice;
+                    bestLms = current;
+                    bestScaleFactor = scaleFactor;
+                }
+            }
+
+            lms[c] = bestLms;
+            lastScaleFactors[c] = bestScaleFactor;
+
+            // Short last slice is padded with zero residuals
+            bestSlice <<= (qoaSliceLength - sliceLength) * 3;
+            WriteQoaU64(write, bestSlice);
+            write += 8;
+        }
+    }
+
+    return size;
+}
+
+// Returns the encoded file, allocated
+unsigned char* EncodeQoa(const AudioClip* clip, int* size) {
+    int frames = (clip->frameCount + qoaFrameLength - 1) / qoaFrameLength;
+    int capacity = qoaFileHeaderSize + frames * GetQoaFrameSize(clip->channels, qoaFrameLength);
+    unsigned char* data = (unsigned char*) malloc(capacity);
+
+    WriteQoaU64(data, ((uint64_t) qoaMagic << 32) | (uint64_t) clip->frameCount);
+    int offset = qoaFileHeaderSize;
+
+    QoaLms lms[qoaMaxChannels];
+    int lastScaleFactors[qoaMaxChannels] = {};
+    for(int c = 0; c < clip->channels; c++) {
+        lms[c] = {};
+        lms[c].weights[2] = -(1 << 13);
+        lms[c].weights[3] = 1 << 14;
+    }
+
+    for(int first = 0; first < clip->frameCount; first += qoaFrameLength) {
+        int frameSamples = clip->frameCount - first < qoaFrameLength ? clip->frameCount - first : qoaFrameLength;
+        offset += EncodeQoaFrame(clip, first, frameSamples, lms, lastScaleFactors, data + offset);
+    }
+
+    *size = offset;
+    return data;
+}
+
+// Decodes the whole file into the clip, returns false when it's broken
+bool DecodeQoa(const unsigned char* data, int size, AudioClip* clip) {
+    int frameCount = size >= qoaFileHeaderSize ? ReadQoaFileHeader(data) : -1;
+    if(frameCount < 0 || size < qoaFileHeaderSize + qoaFrameHeaderSize) {
+        return false;
+    }
+
+    QoaFrameHeader first = ReadQoaFrameHeader(data + qoaFileHeaderSize);
+    clip->channels = first.channels;
+    clip->sampleRate = first.sampleRate;
+    clip->frameCount = frameCount;
+
+    // Room for a whole last frame
+    int capacity = (frameCount + qoaFrameLength) * first.channels;
+    clip->samples = (short*) malloc(capacity * sizeof(short));
+
+    int decoded = 0;
+    int offset = qoaFileHeaderSize;
+    while(decoded < frameCount) {
+        int samples = DecodeQoaFrame(data + offset, size - offset, clip->samples + decoded * clip->channels);
+        if(samples <= 0) {
+            return false;
+        }
+
+        decoded += samples;
+        offset += ReadQoaFrameHeader(data + offset).size;
+    }
+
+    return true;
+}
+
+double ToDb(double value) {
+    return value > 0 ? 20 * log10(value) : -INFINITY;
+}
+
+void MeasureLoudness(const AudioClip* clip, ClipReport* report) {
+    int sampleCount = clip->frameCount * clip->channels;
+    double peak = 0;
+    double sum = 0;
+
+    for(int i = 0; i < sampleCount; i++) {
+        double sample = clip->samples[i] / 32768.0;
+        peak = fabs(sample) > peak ? fabs(sample) : peak;
+        sum += sample * sample;
+    }
+
+    report->peakDb = ToDb(peak);
+    report->rmsDb = ToDb(sampleCount > 0 ? sqrt(sum / sampleCount) : 0);
+}
+
+// Signal to noise ratio of the decoded clip
+double MeasureSnr(const AudioClip* source, const AudioClip* decoded) {
+    int sampleCount = source->frameCount * source->channels;
+    double signal = 0;
+    double noise = 0;
+
+    for(int i = 0; i < sampleCount; i++) {
+        double difference = (double) source->samples[i] - decoded->samples[i];
+        signal += (double) source->samples[i] * source->samples[i];
+        noise += difference * difference;
+    }
+
+    return noise > 0 ? 10 * log10(signal / noise) : INFINITY;
+}
+
+// Best time of the runs, the first ones warm up the caches
+template <typename Decode>
+double TimeDecode(const unsigned char* data, int size, Decode decode) {
+    double best = INFINITY;
+
+    for(int i = 0; i < decodeRuns; i++) {
+        AudioClip clip = {};
+
+        double start = Now();
+        decode(data, size, &clip);
+        double time = Now() - start;
+
+        free(clip.samples);
+        best = time < best ? time : best;
+    }
+
+    return best;
+}
+
+const char* GetFileName(const char* path) {
+    const char* name = path;
+    for(const char* c = path; *c; c++) {
+        if(*c == '/' || *c == '\\') {
+            name = c + 1;
+        }
+    }
+    return name;
+}
+
+// Output path with the directory and the extension replaced
+void GetOutputPath(const char* input, const char* outDir, char* output, int size) {
+    const char* name = GetFileName(input);
+    const char* extension = strrchr(name, '.');
+    int nameLength = extension ? (int) (extension - name) : (int) strlen(name);
+
+    if(outDir) {
+        snprintf(output, size, "%s/%.*s.qoa", outDir, nameLength, name);
+    }
+    else {
+        snprintf(output, size, "%.*s%.*s.qoa", (int) (name - input), input, nameLength, name);
+    }
+}
+
+bool TranscodeClip(const char* inputPath, const char* outDir, ClipReport* report, AudioClip* clip) {
+    int sourceSize = 0;
+    unsigned char* source = ReadWholeFile(inputPath, &sourceSize);
+    if(source == NULL) {
+        return false;
+    }
+
+    *clip = {};
+    if(DecodeWav(source, sourceSize, clip) == false) {
+        printf("%s has to be a 16 or 24 bit PCM WAV\n", inputPath);
+        free(source);
+        return false;
+    }
+
+    char outputPath[maxPathLength];
+    GetOutputPath(inputPath, outDir, outputPath, sizeof(outputPath));
+
+    int qoaSize = 0;
+    unsigned char* qoa = EncodeQoa(clip, &qoaSize);
+
+    FILE* file = fopen(outputPath, "wb");
+    bool written = file && fwrite(qoa, 1, qoaSize, file) == (size_t) qoaSize;
+    if(file) {
+        fclose(file);
+    }
+
+    if(written == false) {
+        printf("Failed to write %s\n", outputPath);
+        free(source);
+        free(qoa);
+        free(clip->samples);
+        return false;
+    }
+
+    *report = {};
+    snprintf(report->name, sizeof(report->name), "%s", GetFileName(outputPath));
+    report->sourceSize = sourceSize;
+    report->qoaSize = qoaSize;
+
+    MeasureLoudness(clip, report);
+
+    AudioClip decoded = {};
+    if(DecodeQoa(qoa, qoaSize, &decoded) == false) {
+        printf("%s doesn't decode back\n", outputPath);
+        report->snrDb = -INFINITY;
+    }
+    else {
+        report->snrDb = MeasureSnr(clip, &decoded);
+    }
+    free(decoded.samples);
+
+    report->wavDecodeTime = TimeDecode(source, sourceSize, DecodeWav);
+    report->qoaDecodeTime = TimeDecode(qoa, qoaSize, DecodeQoa);
+
+    free(source);
+    free(qoa);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* outDir = NULL;
+    const char* manifestPath = NULL;
+    const char* inputs[256];
+    int inputCount = 0;
+
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+
+        if(strcmp(argv[i], "--out") == 0 && hasValue) {
+            outDir = argv[++i];
+        }
+        else if(strcmp(argv[i], "--manifest") == 0 && hasValue) {
+            manifestPath = argv[++i];
+        }
+        else if(argv[i][0] != '-' && inputCount < 256) {
+            inputs[inputCount++] = argv[i];
+        }
+        else {
+            inputCount = 0;
+            break;
+        }
+    }
+
+    if(inputCount == 0) {
+        printf("Usage: %s [--out dir] [--manifest path] input.wav...\n", argv[0]);
+        return 1;
+    }
+
+    FILE* manifest = NULL;
+    if(manifestPath) {
+        manifest = fopen(manifestPath, "w");
+        if(manifest == NULL) {
+            printf("Failed to open manifest %s\n", manifestPath);
+            return 1;
+        }
+
+        fprintf(manifest, "# file sample_rate channels frames seconds peak_dbfs rms_dbfs\n");
+    }
+
+    printf("%-16s %10s %10s %6s %8s %11s %11s\n",
+           "clip", "source", "qoa", "size", "snr", "wav decode", "qoa decode");
+
+    long long totalSource = 0;
+    long long totalQoa = 0;
+    int failed = 0;
+
+    for(int i = 0; i < inputCount; i++) {
+        ClipReport report;
+        AudioClip clip;
+        if(TranscodeClip(inputs[i], outDir, &report, &clip) == false) {
+            failed++;
+            continue;
+        }
+
+        totalSource += report.sourceSize;
+        totalQoa += report.qoaSize;
+
+        printf("%-16s %10d %10d %5.1f%% %5.1f dB %8.3f ms %8.3f ms\n",
+               report.name, report.sourceSize, report.qoaSize, 100.0 * report.qoaSize / report.sourceSize,
+               report.snrDb, report.wavDecodeTime * 1000, report.qoaDecodeTime * 1000);
+
+        if(manifest) {
+            fprintf(manifest, "%s %d %d %d %.3f %.2f %.2f\n", report.name, clip.sampleRate, clip.channels,
+                    clip.frameCount, (double) clip.frameCount / clip.sampleRate, report.peakDb, report.rmsDb);
+        }
+
+        free(clip.samples);
+    }
+
+    if(totalSource > 0) {
+        printf("total: %lld -> %lld bytes, %.1f%%\n", totalSource, totalQoa, 100.0 * totalQoa / totalSource);
+    }
+
+    if(manifest) {
+        fclose(manifest);
+    }
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,350 @@
+// Micro-benchmarks of the math the game runs every frame: the hand
+// transform chain from DrawGame, mouse ray and its intersection with the
+// XY plane (raylib's way and the cached camera's), Vector3Lerp damping
+// and RandomRange. Every benchmark is run
+// in several samples, and ns/op is reported with 95% confidence interval.
+//
+// Usage: bench_math [--samples N] [--sample-ms N] [--json results.json]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "include/raylib.h"
+#include "include/rlgl.h"
+
+#define RAYMATH_IMPLEMENTATION
+#include "include/raymath.h"
+
+#include "game.cpp"
+#include "camera.cpp"
+
+// ================
+// Config
+// ================
+const int screenWidth = 1600;
+const int screenHeight = 900;
+
+const float handScale = 0.6f;
+
+// Picking paths have to agree within these, in world units. raylib
+// unprojects in float with near and far planes 1e5 apart, which is where
+// nearly all of the difference comes from. The cached path is checked
+// against a double precision reference on its own
+const float pickingTolerance = 2e-4f;
+const float cachedPickingTolerance = 1e-5f;
+
+const int maxBenchSamples = 200;
+const int maxBenchResults = 16;
+
+// Inputs are taken from precomputed tables, so the compiler
+// can't fold the work away, and the table fits in L1
+const int inputCount = 256;
+
+struct BenchResult {
+    const char* name;
+    double nsPerOp;
+    double stddev;
+    double ci95;
+    double min;
+    int samples;
+    long long opsPerSample;
+};
+
+struct BenchOptions {
+    int samples;
+    double sampleSeconds;
+    const char* jsonPath;
+};
+
+BenchResult benchResults[maxBenchResults];
+int benchResultCount;
+
+Vector2 mouseInputs[inputCount];
+Vector3 vectorInputs[inputCount];
+
+// Everything computed is folded in here, so it's not optimized out
+volatile float benchSink;
+
+Camera camera;
+CachedCamera cachedCamera;
+
+double Now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Two-sided Student t value for 95% confidence
+double StudentT95(int degreesOfFreedom) {
+    const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+
+    if(degreesOfFreedom < 1) {
+        return 0;
+    }
+
+    if(degreesOfFreedom <= 30) {
+        return table[degreesOfFreedom - 1];
+    }
+
+    return 1.96;
+}
+
+// Runs the benchmark in batches of ops, sized so one sample takes about
+// sampleSeconds, and collects per sample ns/op
+template <typename F>
+void RunBench(const char* name, const BenchOptions* options, F op) {
+    // Calibration, which also warms up caches and branch predictors
+    long long ops = 1;
+    for(;;) {
+        double start = Now();
+        for(long long i = 0; i < ops; i++) {
+            op((int) (i & (inputCount - 1)));
+        }
+        double elapsed = Now() - start;
+
+        if(elapsed >= options->sampleSeconds || ops >= (1ll << 40)) {
+            break;
+        }
+
+        ops *= elapsed > 0 ? (long long) fmin(fmax(options->sampleSeconds / elapsed * 1.1, 2), 100) : 100;
+    }
+
+    double samples[maxBenchSamples] = {};
+    for(int s = 0; s < options->samples; s++) {
+        double start = Now();
+        for(long long i = 0; i < ops; i++) {
+            op((int) (i & (inputCount - 1)));
+        }
+        samples[s] = (Now() - start) * 1e9 / ops;
+    }
+
+    double sum = 0;
+    double min = samples[0];
+    for(int s = 0; s < options->samples; s++) {
+        sum += samples[s];
+        min = fmin(min, samples[s]);
+    }
+    double mean = sum / options->samples;
+
+    double variance = 0;
+    for(int s = 0; s < options->samples; s++) {
+        variance += (samples[s] - mean) * (samples[s] - mean);
+    }
+    variance /= options->samples > 1 ? options->samples - 1 : 1;
+
+    BenchResult* result = &benchResults[benchResultCount++];
+    result->name = name;
+    result->nsPerOp = mean;
+    result->stddev = sqrt(variance);
+    result->ci95 = StudentT95(options->samples - 1) * result->stddev / sqrt((double) options->samples);
+    result->min = min;
+    result->samples = options->samples;
+    result->opsPerSample = ops;
+
+    printf("%-24s %9.3f ns/op  +- %6.3f (95%%)  min %9.3f  [%d x %lld ops]\n", name,
+           result->nsPerOp, result->ci95, result->min, result->samples, result->opsPerSample);
+}
+
+// Same math as GetMouseRay in raylib 4.2 for a perspective camera, which
+// can't be called without a window, since it asks for the screen size
+Ray BenchGetMouseRay(Vector2 mouse, Camera camera) {
+    Ray ray = {};
+
+    float x = (2.0f * mouse.x) / (float) screenWidth - 1.0f;
+    float y = 1.0f - (2.0f * mouse.y) / (float) screenHeight;
+
+    Matrix matView = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix matProj = MatrixPerspective(camera.fovy * DEG2RAD, (double) screenWidth / (double) screenHeight,
+                                       RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+
+    Vector3 nearPoint = Vector3Unproject({ x, y, 0.0f }, matProj, matView);
+    Vector3 farPoint = Vector3Unproject({ x, y, 1.0f }, matProj, matView);
+
+    // raylib computes this one too, even if perspective camera doesn't use it
+    Vector3 cameraPlanePointerPos = Vector3Unproject({ x, y, -1.0f }, matProj, matView);
+    benchSink = cameraPlanePointerPos.x;
+
+    ray.position = camera.position;
+    ray.direction = Vector3Normalize(Vector3Subtract(farPoint, nearPoint));
+
+    return ray;
+}
+
+// Where the ray through the mouse hits the plane z = 0, in double
+// precision, straight from the camera basis and field of view
+Vector3 ReferencePlanePoint(Vector2 mouse, Camera camera) {
+    Vector3 forward = Vector3Normalize(camera.target - camera.position);
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, camera.up));
+    Vector3 up = Vector3CrossProduct(right, forward);
+
+    double halfHeight = tan(camera.fovy * PI / 180.0 * 0.5);
+    double halfWidth = halfHeight * screenWidth / screenHeight;
+    double x = (2.0 * mouse.x / screenWidth - 1.0) * halfWidth;
+    double y = (1.0 - 2.0 * mouse.y / screenHeight) * halfHeight;
+
+    double direction[3] = {
+        forward.x + x * right.x + y * up.x,
+        forward.y + x * right.y + y * up.y,
+        forward.z + x * right.z + y * up.z,
+    };
+    double dist = -camera.position.z / direction[2];
+
+    return { (float) (camera.position.x + direction[0] * dist),
+             (float) (camera.position.y + direction[1] * dist),
+             (float) (camera.position.z + direction[2] * dist) };
+}
+
+void WriteJson(const char* path, const BenchOptions* options) {
+    FILE* file = fopen(path, "w");
+    if(file == NULL) {
+        printf("Failed to open %s\n", path);
+        return;
+    }
+
+    fprintf(file, "{\n  \"samples\": %d,\n  \"sampleSeconds\": %g,\n  \"results\": [\n",
+            options->samples, options->sampleSeconds);
+
+    for(int i = 0; i < benchResultCount; i++) {
+        BenchResult* r = &benchResults[i];
+        fprintf(file, "    {\"name\": \"%s\", \"nsPerOp\": %.4f, \"stddev\": %.4f, \"ci95\": %.4f, "
+                      "\"min\": %.4f, \"samples\": %d, \"opsPerSample\": %lld}%s\n",
+                r->name, r->nsPerOp, r->stddev, r->ci95, r->min, r->samples, r->opsPerSample,
+                i + 1 < benchResultCount ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+
+    printf("Results written to %s\n", path);
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options = {};
+    options.samples = 30;
+    options.sampleSeconds = 0.02;
+
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+
+        if(strcmp(argv[i], "--samples") == 0 && hasValue) {
+            options.samples = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--sample-ms") == 0 && hasValue) {
+            options.sampleSeconds = atof(argv[++i]) / 1000;
+        }
+        else if(strcmp(argv[i], "--json") == 0 && hasValue) {
+            options.jsonPath = argv[++i];
+        }
+        else {
+            printf("Usage: %s [--samples N] [--sample-ms N] [--json results.json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(options.samples < 2 || options.samples > maxBenchSamples || options.sampleSeconds <= 0) {
+        printf("Samples have to be between 2 and %d, sample time positive\n", maxBenchSamples);
+        return 1;
+    }
+
+    // Same camera as the game
+    camera.position = cameraPosition;
+    camera.target = camera.position + Vector3{0, 0, -1};
+    camera.up = Vector3{ 0.0f, 1.0f, 0.0f };
+    camera.fovy = 60.0f;
+    camera.projection = CAMERA_PERSPECTIVE;
+
+    SetCameraView(&cachedCamera, camera);
+    SetCameraViewport(&cachedCamera, screenWidth, screenHeight);
+
+    SeedRandom(1);
+    for(int i = 0; i < inputCount; i++) {
+        mouseInputs[i] = { RandomRange(0.0f, (float) screenWidth), RandomRange(0.0f, (float) screenHeight) };
+        vectorInputs[i] = { RandomRange(-PI, PI), RandomRange(-PI, PI), RandomRange(-PI, PI) };
+    }
+
+    RunBench("hand_transform", &options, [](int i) {
+        Vector3 rotation = vectorInputs[i];
+        Vector3 position = vectorInputs[(i + 1) & (inputCount - 1)];
+
+        Matrix handTransform = MatrixScale(handScale, handScale, handScale);
+        handTransform = handTransform *
+                        MatrixTranslate(0, 0, -1.2f) *
+                        MatrixRotateXYZ(rotation);
+        handTransform = handTransform * MatrixTranslate(position.x, position.y, position.z);
+
+        benchSink = handTransform.m12;
+    });
+
+    RunBench("mouse_ray_plane", &options, [](int i) {
+        Ray ray = BenchGetMouseRay(mouseInputs[i], camera);
+
+        float dist = -ray.position.z / ray.direction.z;
+        Vector3 pointer = ray.position + ray.direction * dist;
+
+        benchSink = pointer.x;
+    });
+
+    RunBench("mouse_ray_plane_cached", &options, [](int i) {
+        Vector3 direction;
+        Vector3 pointer = GetCameraPlanePoint(&cachedCamera, mouseInputs[i], &direction);
+
+        benchSink = pointer.x + direction.x;
+    });
+
+    RunBench("unproject_cached", &options, [](int i) {
+        Vector3 point = UnprojectCameraPoint(&cachedCamera, mouseInputs[i], 1.0f);
+
+        benchSink = point.x;
+    });
+
+    RunBench("vector3_lerp_damping", &options, [](int i) {
+        Vector3 current = vectorInputs[i];
+        Vector3 target = vectorInputs[(i + 7) & (inputCount - 1)];
+
+        Vector3 result = Vector3Lerp(current, target, simulationDeltaTime * handDampFactor);
+
+        benchSink = result.y;
+    });
+
+    RunBench("random_range_float", &options, [](int) {
+        benchSink = RandomRange(jumpTimeMin, jumpTimeMax);
+    });
+
+    RunBench("random_range_int", &options, [](int) {
+        benchSink = (float) RandomRange(jumpsMin, jumpsMax);
+    });
+
+    // Both picking paths have to agree, otherwise the numbers above mean nothing
+    float maxDifference = 0;
+    float maxError = 0;
+    for(int i = 0; i < inputCount; i++) {
+        Ray ray = BenchGetMouseRay(mouseInputs[i], camera);
+        Vector3 expected = ray.position + ray.direction * (-ray.position.z / ray.direction.z);
+        Vector3 pointer = GetCameraPlanePoint(&cachedCamera, mouseInputs[i], NULL);
+        Vector3 reference = ReferencePlanePoint(mouseInputs[i], camera);
+
+        maxDifference = fmaxf(maxDifference, Vector3Distance(expected, pointer));
+        maxError = fmaxf(maxError, Vector3Distance(reference, pointer));
+    }
+    printf("Cached picking max difference: %g from raylib (limit %g), %g from reference (limit %g)\n",
+           maxDifference, pickingTolerance, maxError, cachedPickingTolerance);
+
+    if(options.jsonPath) {
+        WriteJson(options.jsonPath, &options);
+    }
+
+    if(maxDifference > pickingTolerance || maxError > cachedPickingTolerance) {
+        printf("Cached picking is off\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Perspective camera with cached matrices. raylib rebuilds view and
+// projection in every BeginMode3D, and GetMouseRay additionally inverts
+// them and unprojects two points, just to get one ray. Our camera doesn't
+// move, so everything is computed once, and again only after the camera
+// or the viewport changes.
+//
+// Pointer picking doesn't need matrices at all. Ray direction through a
+// screen point is a linear function of the pixel coordinates:
+//
+//   direction = rayBase + x * rayStepX + y * rayStepY
+//
+// so picking is a few multiply-adds, one normalize and one divide.
+
+#include "include/raylib.h"
+#include "include/raymath.h"
+
+// Same clip planes as rlgl uses in BeginMode3D
+const double cameraNearPlane = 0.01;
+const double cameraFarPlane = 1000.0;
+
+struct CachedCamera {
+    Camera camera;
+    Vector2 viewportSize;
+
+    // Set when camera or viewport changed, matrices are rebuilt on next use
+    bool dirty;
+
+    Matrix view;
+    Matrix projection;
+    Matrix viewProjection;
+    Matrix inverseViewProjection;
+
+    // Unnormalized ray direction for a screen point, see above
+    Vector3 rayBase;
+    Vector3 rayStepX;
+    Vector3 rayStepY;
+};
+
+void SetCameraView(CachedCamera* cached, Camera camera) {
+    cached->camera = camera;
+    cached->dirty = true;
+}
+
+// Cheap enough to call every frame, it only marks
+// the camera dirty when the size actually changed
+void SetCameraViewport(CachedCamera* cached, int width, int height) {
+    if(cached->viewportSize.x != width || cached->viewportSize.y != height) {
+        cached->viewportSize = { (float) width, (float) height };
+        cached->dirty = true;
+    }
+}
+
+void UpdateCachedCamera(CachedCamera* cached) {
+    if(cached->dirty == false) {
+        return;
+    }
+
+    Camera* camera = &cached->camera;
+    float width = cached->viewportSize.x;
+    float height = cached->viewportSize.y;
+    double aspect = (double) width / (double) height;
+
+    cached->view = MatrixLookAt(camera->position, camera->target, camera->up);
+    cached->projection = MatrixPerspective(camera->fovy * DEG2RAD, aspect, cameraNearPlane, cameraFarPlane);
+    cached->viewProjection = MatrixMultiply(cached->view, cached->projection);
+    cached->inverseViewProjection = MatrixInvert(cached->viewProjection);
+
+    // Camera basis, the same one MatrixLookAt builds
+    Vector3 forward = Vector3Normalize(Vector3Subtract(camera->target, camera->position));
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(camera->up, Vector3Negate(forward)));
+    Vector3 up = Vector3CrossProduct(Vector3Negate(forward), right);
+
+    // Half size of the image plane at distance 1 in front of the camera
+    float halfHeight = tanf(camera->fovy * DEG2RAD * 0.5f);
+    float halfWidth = halfHeight * (float) aspect;
+
+    // Pixel x maps to -halfWidth..halfWidth left to right,
+    // pixel y to halfHeight..-halfHeight top to bottom
+    cached->rayStepX = Vector3Scale(right, 2.0f * halfWidth / width);
+    cached->rayStepY = Vector3Scale(up, -2.0f * halfHeight / height);
+    cached->rayBase = Vector3Add(forward, Vector3Add(Vector3Scale(right, -halfWidth), Vector3Scale(up, halfHeight)));
+
+    cached->dirty = false;
+}
+
+// Same ray as GetMouseRay gives, without unprojecting
+Ray GetCameraRay(CachedCamera* cached, Vector2 screenPosition) {
+    UpdateCachedCamera(cached);
+
+    Vector3 direction = Vector3Add(cached->rayBase,
+                                   Vector3Add(Vector3Scale(cached->rayStepX, screenPosition.x),
+                                              Vector3Scale(cached->rayStepY, screenPosition.y)));
+
+    Ray ray;
+    ray.position = cached->camera.position;
+    ray.direction = Vector3Normalize(direction);
+
+    return ray;
+}
+
+// Point where the ray through the screen position hits the plane z = 0.
+// Camera must not look along the plane, which ours never does
+Vector3 GetCameraPlanePoint(CachedCamera* cached, Vector2 screenPosition, Vector3* rayDirection) {
+    Ray ray = GetCameraRay(cached, screenPosition);
+
+    float dist = -ray.position.z / ray.direction.z;
+
+    if(rayDirection) {
+        *rayDirection = ray.direction;
+    }
+
+    return Vector3Add(ray.position, Vector3Scale(ray.direction, dist));
+}
+
+// General version for a camera that isn't static, goes through
+// the inverse matrix, but still without inverting it every time
+Vector3 UnprojectCameraPoint(CachedCamera* cached, Vector2 screenPosition, float depth) {
+    UpdateCachedCamera(cached);
+
+    float x = 2.0f * screenPosition.x / cached->viewportSize.x - 1.0f;
+    float y = 1.0f - 2.0f * screenPosition.y / cached->viewportSize.y;
+
+    Quaternion point = QuaternionTransform({ x, y, depth, 1.0f }, cached->inverseViewProjection);
+
+    return { point.x / point.w, point.y / point.w, point.z / point.w };
+}
@@ -0,0 +1,402 @@
+// Checks of the engine parts that are easy to break without noticing,
+// since the game still runs, only looks or sounds a bit off. Runs them
+// all, prints the failures, and returns 1 when there were any.
+// build_tools.sh also builds them with ThreadSanitizer as checks_tsan,
+// and with AddressSanitizer and UndefinedBehaviorSanitizer as checks_asan.
+//
+// Usage: checks
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#include "include/raylib.h"
+
+#define RAYMATH_IMPLEMENTATION
+#include "include/raymath.h"
+
+#include "game.cpp"
+#include "replay.cpp"
+#include "simulation_thread.cpp"
+#include "streaming_voice.cpp"
+#include "audio_mixer.cpp"
+
+#include "render_queue.h"
+
+// ================
+// Render Queue
+// ================
+struct SortedItem {
+    unsigned long long key;
+    int order;
+};
+
+// Same order as CompareRenderItems
+int CompareSortedItems(const void* a, const void* b) {
+    const SortedItem* itemA = (const SortedItem*) a;
+    const SortedItem* itemB = (const SortedItem*) b;
+
+    if(itemA->key != itemB->key) {
+        return itemA->key < itemB->key ? -1 : 1;
+    }
+
+    return itemA->order - itemB->order;
+}
+
+bool CheckRenderQueueOrder() {
+    struct {
+        RenderLayer layer;
+        bool depthWrite;
+        unsigned int material;
+        float depth;
+    } items[] = {
+        // Submitted in the wrong order on purpose
+        { RENDER_LAYER_UI, false, 0, 0 },
+        { RENDER_LAYER_WORLD, false, 1, 2 },
+        { RENDER_LAYER_WORLD, true, 2, 9 },
+        { RENDER_LAYER_WORLD, false, 1, 8 },
+        { RENDER_LAYER_WORLD, true, 2, 3 },
+        { RENDER_LAYER_WORLD, true, 1, 7 },
+        { RENDER_LAYER_BACKGROUND, false, 0, 10 },
+    };
+    const int itemCount = (int) (sizeof(items) / sizeof(items[0]));
+
+    // Background layer, then opaque world items by material and front
+    // to back, then blended world items back to front, then the UI
+    const int expected[itemCount] = { 6, 5, 4, 2, 3, 1, 0 };
+
+    SortedItem sorted[itemCount];
+    for(int i = 0; i < itemCount; i++) {
+        sorted[i].key = GetRenderItemKey(items[i].layer, items[i].depthWrite, items[i].material, items[i].depth);
+        sorted[i].order = i;
+    }
+    qsort(sorted, itemCount, sizeof(SortedItem), CompareSortedItems);
+
+    bool passed = true;
+    for(int i = 0; i < itemCount; i++) {
+        if(sorted[i].order != expected[i]) {
+            printf("Render queue: item %d is drawn at position %d, expected item %d\n", sorted[i].order, i, expected[i]);
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+// ================
+// Simulation Thread
+// ================
+const int threadCheckFrames = 200000;
+
+struct QueueCheckItem {
+    int sequence;
+    int inverse;
+};
+
+SpscQueue<QueueCheckItem, 4> checkQueue;
+SimulationThread checkSimulation;
+
+void PushQueueCheckItems() {
+    for(int i = 0; i < threadCheckFrames; i++) {
+        QueueCheckItem* item;
+        while((item = BeginQueuePush(&checkQueue)) == NULL) {
+            std::this_thread::yield();
+        }
+
+        item->sequence = i;
+        item->inverse = ~i;
+        EndQueuePush(&checkQueue);
+    }
+}
+
+// Items come out in order, and whole, the consumer
+// never sees one the producer is still writing
+bool CheckSpscQueue() {
+    std::thread producer(PushQueueCheckItems);
+
+    bool passed = true;
+    for(int i = 0; i < threadCheckFrames; i++) {
+        QueueCheckItem* item;
+        while((item = PeekQueue(&checkQueue)) == NULL) {
+            std::this_thread::yield();
+        }
+
+        if(passed && (item->sequence != i || item->inverse != ~i)) {
+            printf("Spsc queue: item %d came out as %d\n", i, item->sequence);
+            passed = false;
+        }
+        PopQueue(&checkQueue);
+    }
+
+    producer.join();
+    return passed;
+}
+
+// Snapshot is whole and not older than the last one. The
+// ones from the start have no frame, all their times are 0
+bool CheckSnapshot(const GameSnapshot* snapshot, double* lastTime) {
+    if(snapshot->time < *lastTime || (snapshot->time > 0 && snapshot->inputTime != snapshot->time + 0.5)) {
+        printf("Snapshot: time %.1f with input time %.1f, after time %.1f\n",
+               snapshot->time, snapshot->inputTime, *lastTime);
+        return false;
+    }
+
+    *lastTime = snapshot->time;
+    return true;
+}
+
+// Like the game, frames are pushed and snapshots taken on this thread
+bool CheckSnapshotTripleBuffer() {
+    InitGame();
+    StartSimulationThread(&checkSimulation, 0);
+
+    ReplayFrame input = {};
+    input.frameDelta = simulationDeltaTime;
+    input.stepCount = 1;
+
+    bool passed = true;
+    double lastTime = 0;
+    GameEventMessage message;
+
+    for(int i = 1; i <= threadCheckFrames && passed; i++) {
+        PushSimulationFrame(&checkSimulation, &input, i, i + 0.5);
+        while(PopGameEvents(&checkSimulation, &message)) {
+        }
+
+        passed = CheckSnapshot(AcquireSnapshot(&checkSimulation), &lastTime);
+    }
+
+    // Last frame has to show up at some point
+    while(passed && lastTime < threadCheckFrames) {
+        std::this_thread::yield();
+        while(PopGameEvents(&checkSimulation, &message)) {
+        }
+
+        passed = CheckSnapshot(AcquireSnapshot(&checkSimulation), &lastTime);
+    }
+
+    StopSimulationThread(&checkSimulation);
+    return passed;
+}
+
+// ================
+// Audio Mixer
+// ================
+// raylib isn't linked, the checks call the mixer
+// themselves instead of the audio thread
+AudioStream LoadAudioStream(unsigned int sampleRate, unsigned int sampleSize, unsigned int channels) {
+    static int buffer;
+    AudioStream stream = {};
+    stream.buffer = (rAudioBuffer*) &buffer;
+    stream.sampleRate = sampleRate;
+    stream.sampleSize = sampleSize;
+    stream.channels = channels;
+    return stream;
+}
+
+void UnloadAudioStream(AudioStream stream) {}
+void PlayAudioStream(AudioStream stream) {}
+void SetAudioStreamCallback(AudioStream stream, AudioCallback callback) {}
+
+Wave LoadWave(const char* fileName) {
+    return {};
+}
+
+void UnloadWave(Wave wave) {}
+void WaveFormat(Wave* wave, int sampleRate, int sampleSize, int channels) {}
+
+const int mixerCheckRate = 44100;
+const int mixerCheckFrames = 1024;
+
+float checkOutput[mixerCheckFrames * 2];
+float sineFrames[mixerCheckRate * 2];
+float silentFrames[mixerCheckRate * 2];
+
+void WriteLe(FILE* file, unsigned int value, int bytes) {
+    for(int i = 0; i < bytes; i++) {
+        fputc((value >> (i * 8)) & 0xFF, file);
+    }
+}
+
+// 16 bit stereo, every sample has the value
+bool WriteCheckWav(const char* path, int frames, short value) {
+    FILE* file = fopen(path, "wb");
+    if(file == NULL) {
+        printf("Failed to write %s\n", path);
+        return false;
+    }
+
+    unsigned int dataSize = frames * 4;
+    fwrite("RIFF", 1, 4, file);
+    WriteLe(file, 36 + dataSize, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    WriteLe(file, 16, 4);
+    WriteLe(file, 1, 2);
+    WriteLe(file, 2, 2);
+    WriteLe(file, mixerCheckRate, 4);
+    WriteLe(file, mixerCheckRate * 4, 4);
+    WriteLe(file, 4, 2);
+    WriteLe(file, 16, 2);
+    fwrite("data", 1, 4, file);
+    WriteLe(file, dataSize, 4);
+
+    for(int i = 0; i < frames * 2; i++) {
+        WriteLe(file, (unsigned short) value, 2);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Voice taken over at the peak of a sine fades out instead of
+// dropping to 0, and the handle of the old sound does nothing
+bool CheckMixerSteal() {
+    // Own mixer for every check, commands of one that
+    // failed would still be in the queue
+    static AudioMixer mixer;
+    InitAudioMixer(&mixer, mixerCheckRate);
+
+    // Peak every 100 frames, from frame 25
+    for(int i = 0; i < mixerCheckRate; i++) {
+        sineFrames[i * 2 + 0] = 0.5f * sinf(2 * PI * i / 100);
+        sineFrames[i * 2 + 1] = sineFrames[i * 2 + 0];
+    }
+    MixerSample sine = { sineFrames, mixerCheckRate, mixerCheckRate };
+    MixerSample silence = { silentFrames, mixerCheckRate, mixerCheckRate };
+
+    // Sine is the least important, so it's taken over first
+    MixerHandle sineHandle = PlayMixerSample(&mixer, &sine, 0, 1, 1, 0);
+    for(int i = 1; i < mixerVoiceCount; i++) {
+        PlayMixerSample(&mixer, &silence, 1, 1, 1, 0);
+    }
+
+    MixAudio(&mixer, checkOutput, 25);
+    float last = checkOutput[24 * 2];
+
+    MixerHandle handle = PlayMixerSample(&mixer, &silence, 1, 1, 1, 0);
+    if(handle.voice != sineHandle.voice || IsMixerSoundPlaying(&mixer, sineHandle)) {
+        printf("Mixer: sine wasn't taken over\n");
+        CloseAudioMixer(&mixer);
+        return false;
+    }
+
+    bool passed = true;
+
+    // Would change the sound that plays on the voice now
+    unsigned int commands = mixer.commands.head.load();
+    SetMixerSoundGain(&mixer, sineHandle, 0);
+    StopMixerSound(&mixer, sineHandle);
+    if(mixer.commands.head.load() != commands) {
+        printf("Mixer: handle of the taken over sound still sends commands\n");
+        passed = false;
+    }
+
+    MixAudio(&mixer, checkOutput, mixerCheckFrames);
+
+    float maxStep = 0;
+    for(int i = 0; i < mixerCheckFrames; i++) {
+        maxStep = fmaxf(maxStep, fabsf(checkOutput[i * 2] - last));
+        last = checkOutput[i * 2];
+    }
+
+    // A cut would step by the whole 0.5, the fade by about what the sine does
+    if(maxStep > 0.05f) {
+        printf("Mixer: output steps by %.3f when the sine is taken over\n", maxStep);
+        passed = false;
+    }
+
+    for(int i = mixerFadeFrames; i < mixerCheckFrames; i++) {
+        if(checkOutput[i * 2] != 0 || checkOutput[i * 2 + 1] != 0) {
+            printf("Mixer: sine is still heard at frame %d, after its fade\n", i);
+            passed = false;
+            break;
+        }
+    }
+
+    CloseAudioMixer(&mixer);
+    return passed;
+}
+
+// Clip that takes over a stream is heard right away, before the main
+// thread decodes more of it, the ring is still full of the old clip
+bool CheckMixerStreamSteal() {
+    const char* silencePath = "checks_silence.wav";
+    const char* tonePath = "checks_tone.wav";
+
+    // Tone is a quarter of full scale
+    StreamingClip silence;
+    StreamingClip tone;
+    if(WriteCheckWav(silencePath, mixerCheckRate * 2, 0) == false ||
+       WriteCheckWav(tonePath, mixerCheckRate * 2, 8192) == false ||
+       LoadStreamingClip(&silence, silencePath) == false ||
+       LoadStreamingClip(&tone, tonePath) == false) {
+        remove(silencePath);
+        remove(tonePath);
+        return false;
+    }
+
+    static AudioMixer mixer;
+    InitAudioMixer(&mixer, mixerCheckRate);
+
+    for(int i = 0; i < mixerStreamCount; i++) {
+        PlayMixerClip(&mixer, &silence, 0, 1, 1, 0);
+    }
+    UpdateAudioMixer(&mixer);
+    MixAudio(&mixer, checkOutput, 256);
+
+    bool passed = true;
+
+    MixerHandle handle = PlayMixerClip(&mixer, &tone, 1, 1, 1, 0);
+    if(handle.generation == 0) {
+        printf("Mixer: tone didn't take over a stream\n");
+        passed = false;
+    }
+
+    // No UpdateAudioMixer in between, like a frame that takes long
+    MixAudio(&mixer, checkOutput, mixerCheckFrames);
+
+    for(int i = 0; i < mixerCheckFrames && passed; i++) {
+        if(fabsf(checkOutput[i * 2] - 0.25f) > 0.01f) {
+            printf("Mixer: taken over stream is %.3f at frame %d, expected 0.25\n", checkOutput[i * 2], i);
+            passed = false;
+        }
+    }
+
+    CloseAudioMixer(&mixer);
+    UnloadStreamingClip(&silence);
+    UnloadStreamingClip(&tone);
+    remove(silencePath);
+    remove(tonePath);
+
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    (void) argv;
+    if(argc > 1) {
+        printf("Usage: checks\n");
+        return 1;
+    }
+
+    struct {
+        const char* name;
+        bool (*run)();
+    } checks[] = {
+        { "render queue order", CheckRenderQueueOrder },
+        { "spsc queue", CheckSpscQueue },
+        { "snapshot triple buffer", CheckSnapshotTripleBuffer },
+        { "mixer steal fade", CheckMixerSteal },
+        { "mixer stream steal", CheckMixerStreamSteal },
+    };
+
+    int failed = 0;
+    for(unsigned int i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        bool passed = checks[i].run();
+        printf("%-32s %s\n", checks[i].name, passed ? "ok" : "FAILED");
+        failed += passed ? 0 : 1;
+    }
+
+    return failed > 0 ? 1 : 0;
+}
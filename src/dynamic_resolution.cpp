@@ -0,0 +1,145 @@
+// Dynamic resolution of the 3D scene. The scene is rendered into a part
+// of an offscreen target, which is then stretched over the screen, and
+// everything drawn after that, like the texts, stays at full resolution.
+//
+// Scale follows the measured work of the frames on the GPU, which is what
+// the resolution changes, or on the CPU where the GPU can't be timed. Not
+// the time EndDrawing waits for vsync or the frame limiter. That wait fills every frame up to the budget, so frame to frame
+// time can't tell how much room there is. When the work gets close to the
+// budget, scale goes down right away. When it stays well under it, scale
+// goes up one step after a while.
+
+#include "include/raylib.h"
+#include "include/rlgl.h"
+#include "include/raymath.h"
+
+#include "opengl.h"
+
+const float resolutionScaleStep = 0.05f;
+// Work over this part of the budget lowers the scale, under the other
+// for a while raises it. One step up adds up to (0.55 / 0.5)^2 = 1.21x
+// pixels, so a raise from under the lower one doesn't cross the upper one
+const float resolutionLowerThreshold = 0.9f;
+const float resolutionRaiseThreshold = 0.65f;
+const float resolutionRaiseDelay = 2.0f;
+// Frames are measured after a change only once it shows up
+const float resolutionSettleTime = 0.25f;
+const float resolutionAverageFactor = 0.1f;
+
+struct DynamicResolution {
+    bool enabled;
+
+    float minScale;
+    float maxScale;
+    float scale;
+
+    // Scene is rendered into the bottom left corner of the target,
+    // which has the size of the screen
+    RenderTexture2D target;
+    int width;
+    int height;
+
+    // Seconds
+    float averageWorkTime;
+    float underBudgetTime;
+    float settleTime;
+    double lastFrameTime;
+};
+
+void InitDynamicResolution(DynamicResolution* resolution, float minScale, float maxScale) {
+    *resolution = {};
+    resolution->enabled = true;
+    resolution->minScale = minScale;
+    resolution->maxScale = maxScale;
+    resolution->scale = maxScale;
+}
+
+// Frames weren't drawn for a while, the next one isn't measured
+void PauseDynamicResolution(DynamicResolution* resolution) {
+    resolution->lastFrameTime = 0;
+}
+
+// Called once per drawn frame, with the work time of the previous drawn
+// one. Time from the previous call only paces the delays
+void UpdateDynamicResolution(DynamicResolution* resolution, float workTime, float frameBudget) {
+    double now = GetTime();
+    double last = resolution->lastFrameTime;
+    resolution->lastFrameTime = now;
+
+    if(last == 0 || workTime <= 0) {
+        return;
+    }
+
+    float frameTime = (float) (now - last);
+
+    if(resolution->settleTime > 0) {
+        resolution->settleTime -= frameTime;
+        resolution->averageWorkTime = workTime;
+        return;
+    }
+
+    resolution->averageWorkTime = Lerp(resolution->averageWorkTime, workTime, resolutionAverageFactor);
+
+    float scale = resolution->scale;
+
+    if(resolution->averageWorkTime > frameBudget * resolutionLowerThreshold) {
+        scale -= resolutionScaleStep;
+        resolution->underBudgetTime = 0;
+    }
+    else if(resolution->averageWorkTime < frameBudget * resolutionRaiseThreshold) {
+        resolution->underBudgetTime += frameTime;
+        if(resolution->underBudgetTime >= resolutionRaiseDelay) {
+            scale += resolutionScaleStep;
+            resolution->underBudgetTime = 0;
+        }
+    }
+    else {
+        resolution->underBudgetTime = 0;
+    }
+
+    scale = Clamp(scale, resolution->minScale, resolution->maxScale);
+    if(scale != resolution->scale) {
+        resolution->scale = scale;
+        resolution->settleTime = resolutionSettleTime;
+    }
+}
+
+// Following draws go into the scaled scene, cleared with the background
+void BeginDynamicResolution(DynamicResolution* resolution, Color background) {
+    int screenW = GetScreenWidth();
+    int screenH = GetScreenHeight();
+
+    RenderTexture2D* target = &resolution->target;
+    if(target->id != 0 && (target->texture.width != screenW || target->texture.height != screenH)) {
+        UnloadRenderTexture(*target);
+        *target = {};
+    }
+
+    if(target->id == 0) {
+        *target = LoadRenderTexture(screenW, screenH);
+        SetTextureFilter(target->texture, TEXTURE_FILTER_BILINEAR);
+    }
+
+    // Same aspect ratio as the screen, so the camera projection stays
+    resolution->width = (int) (screenW * resolution->scale + 0.5f);
+    resolution->height = (int) (screenH * resolution->scale + 0.5f);
+
+    BeginTextureMode(*target);
+    rlViewport(0, 0, resolution->width, resolution->height);
+    ClearBackground(background);
+}
+
+// Stretches the scene over the screen
+void EndDynamicResolution(DynamicResolution* resolution) {
+    EndTextureMode();
+
+    // Render texture is upside down, and the scene is at its bottom
+    Rectangle source = { 0, 0, (float) resolution->width, (float) -resolution->height };
+    Rectangle dest = { 0, 0, (float) GetScreenWidth(), (float) GetScreenHeight() };
+
+    // Scene covers everything and was blended already, copied as is
+    rlSetBlendFactors(GL_ONE, GL_ZERO, GL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM);
+    DrawTexturePro(resolution->target.texture, source, dest, {0, 0}, 0, WHITE);
+    EndBlendMode();
+}
@@ -0,0 +1,468 @@
+// Game simulation. It doesn't touch the window, audio device or renderer,
+// so it can be compiled both into the game and into the headless tools.
+// Things that the platform has to react to are reported through gameEvents.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "include/raylib.h"
+#include "include/raymath.h"
+
+struct Fox {
+    Vector3 position;
+    float rotation;
+
+    Vector3 velocity;
+    float   rotationSpeed;
+
+    BoundingBox bounds;
+};
+
+struct FoxAnimationState {
+    float time;
+    bool isJumping;
+
+    float waitTime;
+    int jumps;
+};
+
+// Input for a single simulation step. Pointer is already projected
+// on the XY plane, direction is the one of the ray from the camera
+struct GameInput {
+    Vector3 pointerPosition;
+    Vector3 pointerDirection;
+    bool mousePressed;
+    bool mouseReleased;
+};
+
+// Things that happened during simulation steps, which the
+// platform layer has to react to. It's cleared by the platform
+// after handling, so events from several steps are merged
+struct GameEvents {
+    bool foxHit;
+    bool gameReset;
+    bool handGrabbed;
+    bool handReleased;
+};
+
+// Part of the game state that is interpolated between
+// two simulation steps when rendering
+struct RenderState {
+    Vector3 foxPosition;
+    Vector3 handPosition;
+    Vector3 handRotation;
+};
+
+// ================
+// Config
+// ================
+
+// Simulation runs in fixed steps, independently of the rendering framerate,
+// so the hit speeds and fox trajectory are the same on every machine
+const float simulationRate = 240;
+const float simulationDeltaTime = 1.0f / simulationRate;
+
+const Vector3 cameraPosition = { 2.0f, 1.0f, 6.0f };
+
+// Hand stuff
+const Vector3 handDefaultPosition = {5, 1, 0};
+const Vector3 handDefaultRotation = {0, PI / 2, PI / 2};
+const float handRotationFactor = 0.05f;
+const float handDampFactor = 20;
+
+// Fox
+const float foxScale = 3;
+const Vector3 foxStartPosition = {0, foxScale / 2, 0};
+
+// Fox jump animation
+const int jumpsMin = 1;
+const int jumpsMax = 3;
+const float jumpTimeMin = 1.0f;
+const float jumpTimeMax = 2.0f;
+const float foxJumpHeight = 0.3f;
+const float foxJumpTime = 0.38f;
+
+const float gravity = -9.81f;
+
+// Screams
+const float attenuationFactor = 24;
+const float pitchVariation = 0.08f;
+
+const int HitSoundsCount = 3;
+const int ScreamSoundsCount = 4;
+
+const int resultTextSize = 256;
+
+// ================
+// Tuning
+// ================
+// Not const, so the headless build can sweep them
+float minHitSpeed = 40;
+int   screamSoundThresholds[ScreamSoundsCount] = { 0, 100, 200, 350 };
+
+// ================
+// Game State
+// ================
+// Own random generator instead of rand(), so a recorded
+// session replays the same with every C library
+unsigned int randomState = 1;
+
+Fox fox;
+FoxAnimationState foxAnimationState;
+
+bool handGrabbed;
+bool foxHit;
+
+Vector3 pointerPosition;
+Vector3 previousPointerPos;
+
+Vector3 handPosition;
+float handSpeed;
+Vector3 targetHandRotation;
+Vector3 currentHandRotation = handDefaultRotation;
+
+int   currentHitSoundIndex;
+int   currentScreamIndex;
+float screamPitch;
+float screamVolume;
+
+char resultText[resultTextSize];
+
+bool isInMenu = true;
+bool isPatting;
+
+GameEvents gameEvents;
+
+// ================
+// Operators
+// ================
+Vector3 operator+(Vector3 a, Vector3 b) {
+    return Vector3Add(a, b);
+}
+
+Vector3 operator-(Vector3 a, Vector3 b) {
+    return Vector3Subtract(a, b);
+}
+
+Vector3 operator*(Vector3 v, float s) {
+    return {v.x * s, v.y * s, v.z * s};
+}
+
+Vector3 operator/(Vector3 v, float s) {
+    return {v.x / s, v.y / s, v.z / s};
+}
+
+Vector2 operator+(Vector2 a, Vector2 b) {
+    return Vector2Add(a, b);
+}
+
+Vector2 operator-(Vector2 a, Vector2 b) {
+    return Vector2Subtract(a, b);
+}
+
+Vector2 operator*(Vector2 v, float s) {
+    return {v.x * s, v.y * s};
+}
+
+Vector2 operator/(Vector2 v, float s) {
+    return {v.x / s, v.y / s};
+}
+
+Matrix operator*(Matrix a, Matrix b) {
+    return MatrixMultiply(a, b);
+}
+
+// ================
+// Helper Functions
+// ================
+
+// small hack, since it will work only for types that
+// can be compared to 0, typically numerical, but oh well
+// that's what I need
+template <typename T>
+int sign(T val) {
+    return (0 < val) - (val < 0);
+}
+
+void SeedRandom(unsigned int seed) {
+    // xorshift can't start from 0
+    randomState = seed * 2654435761u + 0x9E3779B9u;
+    if(randomState == 0) {
+        randomState = 1;
+    }
+}
+
+// xorshift32
+unsigned int Random() {
+    unsigned int x = randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    randomState = x;
+
+    return x;
+}
+
+float RandomRange(float a, float b) {
+    float p = (float) (Random() >> 8) / (float) 0xFFFFFF;
+    return Lerp(a, b, p);
+}
+
+int RandomRange(int a, int b) {
+    float p = (float) (Random() >> 8) / (float) 0xFFFFFF;
+    return (int) (Lerp((float)a, (float)b, p) + 0.5f);
+}
+
+////
+void InitGame();
+void UpdateSimulation(const GameInput* input, float dt);
+
+void UpdateMenu(const GameInput* input, float dt);
+void UpdateGame(const GameInput* input, float dt);
+
+void FoxAnimationRoutine(FoxAnimationState*, float dt);
+float GetFoxJumpDelay(const FoxAnimationState* data);
+
+RenderState CaptureRenderState();
+RenderState InterpolateRenderState(RenderState a, RenderState b, float t);
+
+
+void InitGame() {
+    fox.position = foxStartPosition;
+    handPosition = handDefaultPosition;
+
+    Vector3 min = Vector3{1, 1, 1} * -foxScale / 2 + foxStartPosition;
+    Vector3 max = Vector3{1, 1, 1} *  foxScale / 2 + foxStartPosition;
+    fox.bounds  = { min, max };
+}
+
+void UpdateSimulation(const GameInput* input, float dt) {
+    if(isInMenu) {
+        UpdateMenu(input, dt);
+    }
+    else {
+        UpdateGame(input, dt);
+    }
+}
+
+void UpdateMenu(const GameInput* input, float dt) {
+    FoxAnimationRoutine(&foxAnimationState, dt);
+
+    if(input->mousePressed) {
+        isInMenu = false;
+    }
+}
+
+void UpdateGame(const GameInput* input, float dt) {
+    pointerPosition = input->pointerPosition;
+
+    if(handGrabbed == false) {
+        handPosition = Vector3Lerp(handPosition, handDefaultPosition, dt * 4);
+        targetHandRotation = handDefaultRotation;
+
+        if(input->mousePressed) {
+            handGrabbed = true;
+
+            gameEvents.handGrabbed = true;
+        }
+    }
+    else if(foxHit == false) {
+        FoxAnimationRoutine(&foxAnimationState, dt);
+
+        // cheat for testing maximum possible speed
+        // if(IsMouseButtonPressed(1)) {
+        //     ray = GetMouseRay({screenWidth, screenHeight}, camera);
+        //     dist = -ray.position.z / ray.direction.z;
+        //     previousPointerPos = ray.position + ray.direction * dist;
+
+
+        //     ray = GetMouseRay({0, 0}, camera);
+        //     dist = -ray.position.z / ray.direction.z;
+        //     pointerPosition = ray.position + ray.direction * dist;
+        // }
+
+        // Calculate speed of the pointer in the World coordinates
+        Vector3 delta = pointerPosition - previousPointerPos;
+        Vector3 velocity = delta / dt;
+        handSpeed = Vector3Length(delta) / dt * -sign(delta.x);
+
+        handPosition = pointerPosition;
+
+        // Calculate target hand rotation using direction from the camera,
+        // it's used so the hand is rotated away from our view
+        // should look better
+        Vector3 direction = input->pointerDirection;
+        float rayAngle = atan2f(direction.z, direction.x) + PI / 2.0f;
+        targetHandRotation.y = velocity.x * handRotationFactor - rayAngle;
+
+        // Actual logic that handles hitting
+        if(isPatting == false && handPosition.x < fox.position.x && handSpeed > minHitSpeed) {
+            snprintf(resultText, sizeof(resultText), "YOU SPANKED THE FOX AT\n%d KILOMETERS PER HOUR", (int) handSpeed);
+
+            foxHit = true;
+
+            currentHitSoundIndex = Random() % HitSoundsCount;
+
+            currentScreamIndex = ScreamSoundsCount - 1;
+            for(int i = 0; i < ScreamSoundsCount - 1; i++) {
+                if(handSpeed >= screamSoundThresholds[i] && handSpeed < screamSoundThresholds[i + 1]) {
+                    currentScreamIndex = i;
+                    break;
+                }
+            }
+
+            // small pitch variation to hide a little repetiveness
+            // of the screams
+            float r = RandomRange(-pitchVariation, pitchVariation);
+            screamPitch = 1 + r;
+
+            gameEvents.foxHit = true;
+
+            fox.velocity = velocity;
+        }
+
+
+        bool isInBounds = handPosition.x > fox.bounds.min.x && handPosition.x < fox.bounds.max.x &&
+                          handPosition.y > fox.bounds.min.y && handPosition.y < fox.bounds.max.y;
+
+        if(handPosition.x < fox.bounds.max.x && handSpeed < minHitSpeed) {
+            if(isInBounds)
+            {
+                isPatting = true;
+
+                targetHandRotation.x = 30 * DEG2RAD;
+                targetHandRotation.z = 180 * DEG2RAD;
+            }
+        }
+
+        if(isPatting && isInBounds == false) {
+            isPatting = false;
+
+            // targetHandRotation.x = 0;
+            // targetHandRotation.z = 90 * DEG2RAD;
+            targetHandRotation = handDefaultRotation;
+        }
+    }
+
+    if(foxHit) {
+        // simple kinematic equations calculating fox velocity and positions.
+        // Those are:
+        // V = V0 + 1/2 * a * t
+        // S = S0 + V * t
+        // where:
+        // V = velocity
+        // a = acceleration (in this case gravity)
+        // t = time interval
+        // S = position
+        // They are here because at some point I wanted for camera to track the Fox
+        // but it was cut out to save "development" time
+        //
+        // now it's used for sound attenuation
+        fox.velocity = fox.velocity + Vector3{0, 0.5f * gravity * dt, 0};
+        fox.position = fox.position + fox.velocity * dt;
+
+        // Sound attenuation mentioned earlier. It uses simple 1 / x function
+        // multiplied by found factor to "feel" better
+        float distFromCenter = Vector3Length(fox.position);
+        float volume = attenuationFactor / distFromCenter;
+        // Clamp sound volume so it never exceeds 1.
+        screamVolume = volume > 1 ? 1 : volume;
+
+        // Last minute change, when after hit, the hand also move
+        // since it's last minute, I don't store actual hand velocity
+        // and just usuning fox velocity
+        // Since it's on the screen for fraction of a second it's
+        // "good enough"
+        handPosition = handPosition + fox.velocity * dt;
+    }
+
+    // Reset Game State
+    if(foxHit && input->mousePressed) {
+        foxHit = false;
+        handSpeed = 0;
+        resultText[0] = '\0';
+
+        fox.position = foxStartPosition;
+        fox.velocity = {0, 0, 0};
+
+        gameEvents.gameReset = true;
+    }
+
+    if(input->mouseReleased) {
+        handGrabbed = false;
+        isPatting = false;
+
+        targetHandRotation = handDefaultRotation;
+
+        gameEvents.handReleased = true;
+    }
+
+    // calculate hand roation. Here I use very simple damping methos using Lerp function to give it
+    // less jerky movement. Wraning! This method is not framerate-independent, even if you multiply
+    // the factor by frame time. It's fine now since it always runs with fixed step, but it's still
+    // unstable in certain situations
+    // check: https://theorangeduck.com/page/spring-roll-call
+    currentHandRotation = Vector3Lerp(currentHandRotation, targetHandRotation, dt * handDampFactor);
+
+    // Clamp Y rotation to 90 degrees
+    currentHandRotation.y = fminf(currentHandRotation.y, PI / 2);
+
+    previousPointerPos = pointerPosition;
+}
+
+// Coroutine style animation routine
+void FoxAnimationRoutine(FoxAnimationState* data, float dt) {
+    if(data->isJumping == false) {
+        if(isPatting) {
+            return;
+        }
+
+        data->time += dt;
+        if(data->time >= data->waitTime) {
+            data->isJumping = true;
+            data->time = 0;
+
+            data->jumps = RandomRange(jumpsMin, jumpsMax);
+        }
+    }
+    else {
+        data->time += dt;
+
+        fox.position.y = foxStartPosition.y + foxJumpHeight * fabsf(sinf(data->time * PI / foxJumpTime));
+
+        if(data->time >= data->jumps * foxJumpTime) {
+            data->isJumping = false;
+            data->time = 0;
+
+            data->waitTime = RandomRange(jumpTimeMin, jumpTimeMax);
+        }
+    }
+}
+
+// Time until the fox starts jumping again, it stands still until then
+float GetFoxJumpDelay(const FoxAnimationState* data) {
+    if(data->isJumping) {
+        return 0;
+    }
+
+    return fmaxf(data->waitTime - data->time, 0);
+}
+
+RenderState CaptureRenderState() {
+    RenderState state;
+    state.foxPosition  = fox.position;
+    state.handPosition = handPosition;
+    state.handRotation = currentHandRotation;
+
+    return state;
+}
+
+RenderState InterpolateRenderState(RenderState a, RenderState b, float t) {
+    RenderState state;
+    state.foxPosition  = Vector3Lerp(a.foxPosition,  b.foxPosition,  t);
+    state.handPosition = Vector3Lerp(a.handPosition, b.handPosition, t);
+    state.handRotation = Vector3Lerp(a.handRotation, b.handRotation, t);
+
+    return state;
+}
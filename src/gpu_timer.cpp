@@ -0,0 +1,304 @@
+// GPU timing of the render passes, with GL timestamp queries. A timestamp
+// is written whenever the pass changes, and the time up to the next one
+// goes to the pass that was running. Every frame, pending frames are read
+// oldest first, those whose queries are all available, so reading never
+// waits. A frame whose results still aren't there when its slot is
+// needed again, gpuTimerLatency frames later, is dropped.
+//
+// rlgl records batched draws only when the batch is flushed, so while
+// timing, the batch is flushed at every pass change too. It's enabled
+// only when the overlay, the log or the dynamic resolution needs it, and
+// passes are timed only for the first two, the last needs just the total.
+//
+// Not available on the web, WebGL timer queries are mostly disabled.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "include/raylib.h"
+#include "include/rlgl.h"
+#include "include/raymath.h"
+
+#include "opengl.h"
+
+enum GpuPass {
+    // Everything that isn't in the passes below, e.g. clears,
+    // the menu overlay and upscaling the scene
+    GPU_PASS_OTHER,
+
+    GPU_PASS_STATIC_MESHES,
+    GPU_PASS_MESHES,
+    GPU_PASS_BILLBOARDS,
+    GPU_PASS_TEXT,
+
+    GPU_PASS_COUNT,
+};
+
+const char* gpuPassNames[GPU_PASS_COUNT] = {
+    "Other",
+    "Static meshes",
+    "Meshes",
+    "Billboards",
+    "Text",
+};
+
+// Whole frame is one more row after the passes
+const int gpuTimerRowCount = GPU_PASS_COUNT + 1;
+const int gpuTimerTotalRow = GPU_PASS_COUNT;
+
+const int gpuTimerLatency = 4;
+const int gpuTimerMaxSegments = 32;
+const float gpuTimerAverageFactor = 0.05f;
+
+struct GpuTimerFrame {
+    // Timestamp i starts segment i, the last one ends the frame
+    unsigned int queries[gpuTimerMaxSegments + 1];
+    GpuPass passes[gpuTimerMaxSegments];
+    int segmentCount;
+
+    long long frameIndex;
+    bool pending;
+};
+
+struct GpuTimer {
+    bool supported;
+    // Set by the platform, frames are measured only when it's on,
+    // and split into passes only when the second one is on too
+    bool enabled;
+    bool timePasses;
+
+    GlGenQueries genQueries;
+    GlDeleteQueries deleteQueries;
+    GlQueryCounter queryCounter;
+    GlGetQueryObjectiv getQueryObjectiv;
+    GlGetQueryObjectui64v getQueryObjectui64v;
+
+    GpuTimerFrame frames[gpuTimerLatency];
+    long long frameIndex;
+
+    // Frame being measured, NULL outside of it
+    GpuTimerFrame* current;
+    GpuPass pass;
+
+    // Milliseconds, of the last read frame and averaged
+    float last[gpuTimerRowCount];
+    float average[gpuTimerRowCount];
+    int droppedFrames;
+
+    FILE* log;
+};
+
+// Needs the GL context. Returns false when timer queries aren't there,
+// the timer then does nothing
+bool InitGpuTimer(GpuTimer* timer) {
+    memset(timer, 0, sizeof(*timer));
+
+    // Loaded pointers don't prove anything, GLX gives one for any name
+    if(HasGlVersion(3, 3) == false && HasGlExtension("GL_ARB_timer_query") == false) {
+        printf("GPU timer queries aren't supported\n");
+        return false;
+    }
+
+    timer->genQueries = (GlGenQueries) GetGlProcAddress("glGenQueries");
+    timer->deleteQueries = (GlDeleteQueries) GetGlProcAddress("glDeleteQueries");
+    timer->queryCounter = (GlQueryCounter) GetGlProcAddress("glQueryCounter");
+    timer->getQueryObjectiv = (GlGetQueryObjectiv) GetGlProcAddress("glGetQueryObjectiv");
+    timer->getQueryObjectui64v = (GlGetQueryObjectui64v) GetGlProcAddress("glGetQueryObjectui64v");
+
+    timer->supported = timer->genQueries && timer->deleteQueries && timer->queryCounter &&
+                       timer->getQueryObjectiv && timer->getQueryObjectui64v;
+
+    if(timer->supported == false) {
+        printf("GPU timer queries aren't supported\n");
+        return false;
+    }
+
+    for(int i = 0; i < gpuTimerLatency; i++) {
+        timer->genQueries(gpuTimerMaxSegments + 1, timer->frames[i].queries);
+    }
+
+    return true;
+}
+
+void CloseGpuTimer(GpuTimer* timer) {
+    if(timer->log) {
+        fclose(timer->log);
+        timer->log = NULL;
+    }
+
+    if(timer->supported) {
+        for(int i = 0; i < gpuTimerLatency; i++) {
+            timer->deleteQueries(gpuTimerMaxSegments + 1, timer->frames[i].queries);
+        }
+    }
+
+    timer->supported = false;
+}
+
+// CSV with a line per measured frame, times in milliseconds
+bool OpenGpuTimerLog(GpuTimer* timer, const char* path) {
+    timer->log = fopen(path, "w");
+    if(timer->log == NULL) {
+        printf("Failed to open GPU timer log %s\n", path);
+        return false;
+    }
+
+    fprintf(timer->log, "frame");
+    for(int i = 0; i < GPU_PASS_COUNT; i++) {
+        fprintf(timer->log, ",%s", gpuPassNames[i]);
+    }
+    fprintf(timer->log, ",Total\n");
+
+    return true;
+}
+
+void WriteGpuTimestamp(GpuTimer* timer, GpuPass pass) {
+    GpuTimerFrame* frame = timer->current;
+
+    timer->queryCounter(frame->queries[frame->segmentCount], GL_TIMESTAMP);
+    frame->passes[frame->segmentCount] = pass;
+    frame->segmentCount++;
+
+    timer->pass = pass;
+}
+
+// Returns false when some result of the frame isn't available yet,
+// then nothing is read and the frame stays pending
+bool ReadGpuTimerFrame(GpuTimer* timer, GpuTimerFrame* frame) {
+    // Queries don't have to finish in order, each one is checked
+    for(int i = 0; i <= frame->segmentCount; i++) {
+        int available = 0;
+        timer->getQueryObjectiv(frame->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available == 0) {
+            return false;
+        }
+    }
+
+    frame->pending = false;
+
+    unsigned long long timestamps[gpuTimerMaxSegments + 1];
+    for(int i = 0; i <= frame->segmentCount; i++) {
+        timer->getQueryObjectui64v(frame->queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    float times[gpuTimerRowCount] = {};
+    for(int i = 0; i < frame->segmentCount; i++) {
+        times[frame->passes[i]] += (float) ((timestamps[i + 1] - timestamps[i]) / 1e6);
+    }
+    times[gpuTimerTotalRow] = (float) ((timestamps[frame->segmentCount] - timestamps[0]) / 1e6);
+
+    for(int i = 0; i < gpuTimerRowCount; i++) {
+        timer->last[i] = times[i];
+        timer->average[i] = Lerp(timer->average[i], times[i], gpuTimerAverageFactor);
+    }
+
+    if(timer->log) {
+        fprintf(timer->log, "%lld", frame->frameIndex);
+        for(int i = 0; i < gpuTimerRowCount; i++) {
+            fprintf(timer->log, ",%.4f", times[i]);
+        }
+        fprintf(timer->log, "\n");
+    }
+
+    return true;
+}
+
+// Call before anything of the frame is drawn
+void GpuTimerBeginFrame(GpuTimer* timer) {
+    timer->current = NULL;
+
+    if(timer->supported == false || timer->enabled == false) {
+        return;
+    }
+
+    // Oldest first, and only up to the first one that isn't ready,
+    // so the log and the averages get the frames in order
+    for(long long i = timer->frameIndex - gpuTimerLatency; i < timer->frameIndex; i++) {
+        GpuTimerFrame* pending = &timer->frames[i % gpuTimerLatency];
+        if(i < 0 || pending->pending == false || pending->frameIndex != i) {
+            continue;
+        }
+
+        if(ReadGpuTimerFrame(timer, pending) == false) {
+            break;
+        }
+    }
+
+    // Slot of this frame, its results would be overwritten
+    GpuTimerFrame* frame = &timer->frames[timer->frameIndex % gpuTimerLatency];
+    if(frame->pending) {
+        frame->pending = false;
+        timer->droppedFrames++;
+    }
+
+    frame->segmentCount = 0;
+    frame->frameIndex = timer->frameIndex;
+    timer->current = frame;
+
+    rlDrawRenderBatchActive();
+    WriteGpuTimestamp(timer, GPU_PASS_OTHER);
+}
+
+// Following draws belong to the pass
+void GpuTimerSetPass(GpuTimer* timer, GpuPass pass) {
+    if(timer->current == NULL || timer->timePasses == false || timer->pass == pass) {
+        return;
+    }
+
+    // Out of queries, the rest goes to the current pass
+    if(timer->current->segmentCount == gpuTimerMaxSegments) {
+        return;
+    }
+
+    rlDrawRenderBatchActive();
+    WriteGpuTimestamp(timer, pass);
+}
+
+void GpuTimerEndFrame(GpuTimer* timer) {
+    GpuTimerFrame* frame = timer->current;
+    if(frame == NULL) {
+        return;
+    }
+
+    rlDrawRenderBatchActive();
+    timer->queryCounter(frame->queries[frame->segmentCount], GL_TIMESTAMP);
+
+    frame->pending = true;
+    timer->frameIndex++;
+    timer->current = NULL;
+}
+
+void DrawGpuTimer(GpuTimer* timer, int x, int y) {
+    const int textSize = 20;
+    const int lineHeight = 24;
+    const int panelWidth = 400;
+    const int nameWidth = 160;
+    const int columnWidth = 110;
+
+    if(timer->supported == false) {
+        DrawRectangle(x, y, panelWidth, lineHeight + 12, {0, 0, 0, 180});
+        DrawText("GPU timer queries not supported", x + 10, y + 6, textSize, WHITE);
+        return;
+    }
+
+    int panelHeight = (gpuTimerRowCount + 2) * lineHeight + 12;
+    DrawRectangle(x, y, panelWidth, panelHeight, {0, 0, 0, 180});
+
+    int textX = x + 10;
+    int textY = y + 6;
+    DrawText("GPU pass", textX, textY, textSize, WHITE);
+    DrawText("avg", textX + nameWidth, textY, textSize, WHITE);
+    DrawText("last [ms]", textX + nameWidth + columnWidth, textY, textSize, WHITE);
+    textY += lineHeight;
+
+    for(int i = 0; i < gpuTimerRowCount; i++) {
+        const char* name = i == gpuTimerTotalRow ? "Total" : gpuPassNames[i];
+
+        DrawText(name, textX, textY, textSize, WHITE);
+        DrawText(TextFormat("%.3f", timer->average[i]), textX + nameWidth, textY, textSize, WHITE);
+        DrawText(TextFormat("%.3f", timer->last[i]), textX + nameWidth + columnWidth, textY, textSize, WHITE);
+        textY += lineHeight;
+    }
+
+    DrawText(TextFormat("Frames not ready in time: %d", timer->droppedFrames), textX, textY, textSize, LIGHTGRAY);
+}
@@ -0,0 +1,450 @@
+// Headless build of the game simulation, used for tuning minHitSpeed and
+// screamSoundThresholds. It drives synthetic swings through UpdateSimulation
+// as fast as possible and prints histograms of the resulting hit speeds
+// and scream tiers. No window, audio device or renderer is created.
+// It can also replay a recorded session and report every hit in it.
+//
+// Usage: headless [--swings N] [--jobs N] [--seed N] [--min-hit-speed X]
+//                 [--thresholds a,b,c] [--bin-size X]
+//        headless --replay session.bin
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "include/raylib.h"
+
+#define RAYMATH_IMPLEMENTATION
+#include "include/raymath.h"
+
+#include "game.cpp"
+#include "replay.cpp"
+
+// ================
+// Config
+// ================
+const int histogramBins = 64;
+
+// Swing generator, all in world units and seconds
+const float swingStartMin = 0.25f;     // distance right of the fox bounds
+const float swingStartMax = 2.5f;
+const float swingEndMin = 0.5f;        // distance left of the fox center
+const float swingEndMax = 3.0f;
+const float swingDurationMin = 0.02f;
+const float swingDurationMax = 0.4f;
+// Steps simulated after the swing ends, so slow swings can still be resolved
+const int swingSettleSteps = 4;
+
+struct SweepResults {
+    long long swings;
+    long long hits;
+    long long pats;
+    long long misses;
+
+    long long speedHistogram[histogramBins];
+    long long screamHistogram[ScreamSoundsCount];
+
+    float minSpeed;
+    float maxSpeed;
+    double speedSum;
+};
+
+struct SweepOptions {
+    long long swings;
+    int jobs;
+    unsigned int seed;
+    float binSize;
+
+    const char* replayPath;
+};
+
+// Separate generator for the swing paths, so the one used
+// by the simulation itself stays untouched
+unsigned int swingRandomState;
+
+float SwingRandom(float a, float b) {
+    // xorshift32
+    unsigned int x = swingRandomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    swingRandomState = x;
+
+    return Lerp(a, b, (float) (x >> 8) / (float) (1 << 24));
+}
+
+void ResetForSwing() {
+    isInMenu = false;
+    handGrabbed = false;
+    foxHit = false;
+    isPatting = false;
+    handSpeed = 0;
+
+    fox.position = foxStartPosition;
+    fox.velocity = {0, 0, 0};
+    handPosition = handDefaultPosition;
+    currentHandRotation = handDefaultRotation;
+    targetHandRotation = handDefaultRotation;
+}
+
+GameInput SwingInput(Vector3 position) {
+    GameInput input = {};
+    input.pointerPosition = position;
+    input.pointerDirection = Vector3Normalize(position - cameraPosition);
+
+    return input;
+}
+
+void SimulateSwing(SweepResults* results, float binSize) {
+    ResetForSwing();
+
+    float y = SwingRandom(fox.bounds.min.y + 0.05f, fox.bounds.max.y - 0.05f);
+    float startX = fox.bounds.max.x + SwingRandom(swingStartMin, swingStartMax);
+    float endX = fox.position.x - SwingRandom(swingEndMin, swingEndMax);
+    float duration = SwingRandom(swingDurationMin, swingDurationMax);
+
+    // Mix linear swings with eased ones, which accelerate through the fox
+    bool eased = SwingRandom(0, 1) < 0.5f;
+
+    Vector3 start = {startX, y, 0};
+    Vector3 end = {endX, y, 0};
+
+    // Grab the hand at the start of the swing
+    GameInput input = SwingInput(start);
+    input.mousePressed = true;
+    UpdateSimulation(&input, simulationDeltaTime);
+
+    int steps = (int) ceilf(duration / simulationDeltaTime);
+    for(int i = 1; i <= steps + swingSettleSteps && foxHit == false; i++) {
+        float t = fminf((float) i / steps, 1);
+        if(eased) {
+            t = t * t * (3 - 2 * t);
+        }
+
+        input = SwingInput(Vector3Lerp(start, end, t));
+        UpdateSimulation(&input, simulationDeltaTime);
+        gameEvents = {};
+    }
+
+    results->swings++;
+
+    if(foxHit) {
+        results->hits++;
+
+        int bin = (int) (handSpeed / binSize);
+        bin = bin < histogramBins ? bin : histogramBins - 1;
+        results->speedHistogram[bin]++;
+        results->screamHistogram[currentScreamIndex]++;
+
+        results->minSpeed = fminf(results->minSpeed, handSpeed);
+        results->maxSpeed = fmaxf(results->maxSpeed, handSpeed);
+        results->speedSum += handSpeed;
+    }
+    else if(isPatting) {
+        results->pats++;
+    }
+    else {
+        results->misses++;
+    }
+
+    gameEvents = {};
+}
+
+void RunSweep(SweepResults* results, long long swings, unsigned int seed, float binSize) {
+    memset(results, 0, sizeof(*results));
+    results->minSpeed = INFINITY;
+
+    SeedRandom(seed);
+    swingRandomState = seed * 2654435761u + 1;
+
+    InitGame();
+
+    for(long long i = 0; i < swings; i++) {
+        SimulateSwing(results, binSize);
+    }
+}
+
+void MergeResults(SweepResults* a, const SweepResults* b) {
+    a->swings += b->swings;
+    a->hits   += b->hits;
+    a->pats   += b->pats;
+    a->misses += b->misses;
+
+    for(int i = 0; i < histogramBins; i++) {
+        a->speedHistogram[i] += b->speedHistogram[i];
+    }
+
+    for(int i = 0; i < ScreamSoundsCount; i++) {
+        a->screamHistogram[i] += b->screamHistogram[i];
+    }
+
+    a->minSpeed = fminf(a->minSpeed, b->minSpeed);
+    a->maxSpeed = fmaxf(a->maxSpeed, b->maxSpeed);
+    a->speedSum += b->speedSum;
+}
+
+// Splits the swings between forked worker processes, since the
+// simulation lives in globals and can't run on several threads
+void RunSweepJobs(SweepResults* results, SweepOptions* options) {
+#if defined(_WIN32)
+    options->jobs = 1;
+#endif
+
+    if(options->jobs <= 1) {
+        RunSweep(results, options->swings, options->seed, options->binSize);
+        return;
+    }
+
+#if !defined(_WIN32)
+    memset(results, 0, sizeof(*results));
+    results->minSpeed = INFINITY;
+
+    int pipes[64][2];
+    int jobs = options->jobs < 64 ? options->jobs : 64;
+
+    for(int i = 0; i < jobs; i++) {
+        long long swings = options->swings / jobs + (i < options->swings % jobs ? 1 : 0);
+
+        if(pipe(pipes[i]) != 0) {
+            perror("pipe");
+            exit(1);
+        }
+
+        pid_t pid = fork();
+        if(pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+
+        if(pid == 0) {
+            close(pipes[i][0]);
+
+            SweepResults jobResults;
+            RunSweep(&jobResults, swings, options->seed + i * 7919, options->binSize);
+
+            ssize_t written = write(pipes[i][1], &jobResults, sizeof(jobResults));
+            _exit(written == (ssize_t) sizeof(jobResults) ? 0 : 1);
+        }
+
+        close(pipes[i][1]);
+    }
+
+    for(int i = 0; i < jobs; i++) {
+        SweepResults jobResults;
+        ssize_t bytes = 0;
+        while(bytes < (ssize_t) sizeof(jobResults)) {
+            ssize_t r = read(pipes[i][0], (char*) &jobResults + bytes, sizeof(jobResults) - bytes);
+            if(r <= 0) {
+                fprintf(stderr, "Job %d failed\n", i);
+                exit(1);
+            }
+            bytes += r;
+        }
+
+        close(pipes[i][0]);
+        MergeResults(results, &jobResults);
+    }
+
+    while(wait(NULL) > 0) {}
+#endif
+}
+
+double GetSeconds() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// FNV-1a, used to compare the final state of two replays
+unsigned int HashBytes(unsigned int hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Feeds a recorded session through the simulation, step by step,
+// exactly the same way the game did
+int RunReplay(const char* path) {
+    ReplayFile replay;
+    if(OpenReplayPlayer(&replay, path) == false) {
+        return 1;
+    }
+
+    printf("seed:   %u\n", replay.header.seed);
+
+    SeedRandom(replay.header.seed);
+    InitGame();
+
+    static ReplayFrame frame;
+    long long steps = 0;
+    int hits = 0;
+    double recordedTime = 0;
+    unsigned int hash = 2166136261u;
+
+    double start = GetSeconds();
+
+    while(ReadReplayFrame(&replay, &frame)) {
+        for(int i = 0; i < frame.stepCount; i++) {
+            UpdateSimulation(&frame.steps[i], simulationDeltaTime);
+            steps++;
+
+            if(gameEvents.foxHit) {
+                hits++;
+                printf("hit %3d: frame %lld, %.3f s, %.2f km/h, scream%d\n", hits,
+                       replay.frameIndex - 1, recordedTime, handSpeed, currentScreamIndex);
+            }
+
+            gameEvents = {};
+        }
+
+        recordedTime += frame.frameDelta;
+
+        hash = HashBytes(hash, &fox.position, sizeof(fox.position));
+        hash = HashBytes(hash, &handPosition, sizeof(handPosition));
+        hash = HashBytes(hash, &handSpeed, sizeof(handSpeed));
+    }
+
+    double seconds = GetSeconds() - start;
+
+    printf("frames: %lld (%.1f s recorded)\n", replay.frameIndex, recordedTime);
+    printf("steps:  %lld (%.2f M/s)\n", steps, seconds > 0 ? steps / seconds / 1e6 : 0);
+    printf("hits:   %d\n", hits);
+    printf("state:  %08x\n", hash);
+
+    CloseReplay(&replay);
+
+    return 0;
+}
+
+void PrintBar(long long count, long long maxCount) {
+    const int width = 50;
+    int n = maxCount > 0 ? (int) (count * width / maxCount) : 0;
+    for(int i = 0; i < n; i++) {
+        putchar('#');
+    }
+    putchar('\n');
+}
+
+void PrintResults(const SweepResults* results, const SweepOptions* options, double seconds) {
+    printf("swings:        %lld (%.2f M/s, %d jobs)\n", results->swings,
+           results->swings / seconds / 1e6, options->jobs);
+    printf("hits:          %lld (%.1f%%)\n", results->hits, 100.0 * results->hits / results->swings);
+    printf("pats:          %lld\n", results->pats);
+    printf("too slow:      %lld\n", results->misses);
+    printf("min hit speed: %.1f\n", minHitSpeed);
+
+    if(results->hits == 0) {
+        return;
+    }
+
+    printf("speed min/avg/max: %.1f / %.1f / %.1f km/h\n\n",
+           results->minSpeed, results->speedSum / results->hits, results->maxSpeed);
+
+    long long maxCount = 0;
+    int lastBin = 0;
+    for(int i = 0; i < histogramBins; i++) {
+        if(results->speedHistogram[i] > maxCount) {
+            maxCount = results->speedHistogram[i];
+        }
+        if(results->speedHistogram[i] > 0) {
+            lastBin = i;
+        }
+    }
+
+    printf("Hit speed histogram [km/h]\n");
+    for(int i = 0; i <= lastBin; i++) {
+        const char* format = i == histogramBins - 1 ? "%5.0f+     %10lld " : "%5.0f-%-5.0f %10lld ";
+        printf(format, i * options->binSize, (i + 1) * options->binSize, results->speedHistogram[i]);
+        PrintBar(results->speedHistogram[i], maxCount);
+    }
+
+    printf("\nScream tiers\n");
+    for(int i = 0; i < ScreamSoundsCount; i++) {
+        printf("scream%d (>= %4d) %10lld %5.1f%%\n", i, screamSoundThresholds[i],
+               results->screamHistogram[i], 100.0 * results->screamHistogram[i] / results->hits);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    SweepOptions options = {};
+    options.swings = 1000000;
+#if defined(_WIN32)
+    options.jobs = 1;
+#else
+    options.jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    options.seed = (unsigned int) time(NULL);
+    options.binSize = 10;
+
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+
+        if(strcmp(argv[i], "--swings") == 0 && hasValue) {
+            options.swings = atoll(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--jobs") == 0 && hasValue) {
+            options.jobs = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = (unsigned int) strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--min-hit-speed") == 0 && hasValue) {
+            minHitSpeed = (float) atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--bin-size") == 0 && hasValue) {
+            options.binSize = (float) atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && hasValue) {
+            options.replayPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--thresholds") == 0 && hasValue) {
+            // First threshold is always 0, so only the upper ones are given
+            char* cursor = argv[++i];
+            for(int t = 1; t < ScreamSoundsCount && *cursor; t++) {
+                screamSoundThresholds[t] = (int) strtol(cursor, &cursor, 10);
+                if(*cursor == ',') {
+                    cursor++;
+                }
+            }
+        }
+        else {
+            printf("Usage: %s [--swings N] [--jobs N] [--seed N] [--min-hit-speed X] "
+                   "[--thresholds a,b,c] [--bin-size X]\n", argv[0]);
+            printf("       %s --replay session.bin\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(options.replayPath) {
+        return RunReplay(options.replayPath);
+    }
+
+    if(options.swings <= 0 || options.binSize <= 0) {
+        printf("Swings and bin size have to be positive\n");
+        return 1;
+    }
+
+    printf("seed:          %u\n", options.seed);
+
+    SweepResults results;
+
+    double start = GetSeconds();
+    RunSweepJobs(&results, &options);
+    double seconds = GetSeconds() - start;
+
+    PrintResults(&results, &options, seconds);
+
+    return 0;
+}
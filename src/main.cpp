@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <assert.h>
+#include <string.h>
 
 #include "include/raylib.h"
 #include "include/rlgl.h"
@@ -15,60 +16,59 @@
 #define RAYMATH_IMPLEMENTATION
 #include "include/raymath.h"
 
-struct Fox {
-    Vector3 position;
-    float rotation;
-
-    Vector3 velocity;
-    float   rotationSpeed;
-
-    BoundingBox bounds;
-
-    Texture2D texture;
-};
-
-struct FoxAnimationState {
-    float time;
-    bool isJumping;
-
-    float waitTime;
-    int jumps;
-};
+#include "game.cpp"
+#include "profiler.cpp"
+#include "gpu_timer.cpp"
+#include "pointer_sampler.cpp"
+#include "replay.cpp"
+#include "simulation_thread.cpp"
+#include "camera.cpp"
+#include "static_mesh.cpp"
+#include "sdf_text.cpp"
+#include "texture_atlas.cpp"
+#include "mesh_file.cpp"
+#include "render_queue.cpp"
+#include "dynamic_resolution.cpp"
+#include "streaming_voice.cpp"
+#include "audio_mixer.cpp"
 
 // ================
-// Config 
+// Config
 // ================
 const int screenWidth = 1600;
 const int screenHeight = 900;
 
 const int fontSize = 70;
 
-const float minHitSpeed = 40;
+const Color backgroundColor = {219, 216, 225, 0};
+
+const int targetFPS = 60;
+// Menu frames that would look the same as the last one aren't drawn.
+// The loop sleeps instead, waking up this often to poll input
+const double idleFrameTime = 0.05;
+// Music stream buffer, long enough to last through an idle frame
+const unsigned int musicBufferFrames = 8192;
+// Hits and screams are mixed on the audio thread, so their
+// buffer only has to cover the audio callback, not frames
+const unsigned int mixerBufferFrames = 1024;
+const int mixerSampleRate = 44100;
+
+// Bounds of the 3D scene resolution, relative to the screen. It's
+// lowered when frames don't fit into the budget, texts stay sharp
+const float minResolutionScale = 0.5f;
+const float maxResolutionScale = 1.0f;
+// Upper limit of simulation steps per rendered frame, so a long
+// hitch doesn't make us fall further and further behind
+const int maxSimulationSteps = 60;
+static_assert(maxSimulationSteps <= replayMaxSteps, "Replay can't store all steps of a frame");
 
-// Hand stuff
-const Vector3 handDefaultPosition = {5, 1, 0};
-const Vector3 handDefaultRotation = {0, PI / 2, PI / 2};
 const float handScale = 0.6f;
-const float handRotationFactor = 0.05f;
-const float handDampFactor = 20;
-
-// Fox
-const float foxScale = 3;
-const Vector3 foxStartPosition = {0, foxScale / 2, 0};
-
-// Fox jump animation
-const int jumpsMin = 1;
-const int jumpsMax = 3;
-const float jumpTimeMin = 1.0f;
-const float jumpTimeMax = 2.0f;
-const float foxJumpHeight = 0.3f;
-const float foxJumpTime = 0.38f;
 
-const float gravity = -9.81f;
+const int profilerToggleKey = KEY_F3;
+const int lateLatchToggleKey = KEY_F4;
 
-// Screams 
-const float attenuationFactor = 24;
-const float pitchVariation = 0.08f;
+// Smoothing of the displayed hand latency
+const float latencyAverageFactor = 0.05f;
 
 // ================
 // Menu
@@ -94,421 +94,613 @@ Thank you Tenma for amazing screams!
 
 // ================
 // Assets
-// ================ 
-Model hand;
+// ================
 Mesh handMesh;
 Material handMaterial;
 
-Texture2D handTexture;
+// Fox and the hand texture, everything textured in the scene uses it
+TextureAtlas atlas;
+Rectangle foxSprite;
+
+StaticMesh gridMesh;
+
+// Large texts, title and result
+SdfFont* sdfFont;
 
-// Sounds
-const int HitSoundsCount = 3;
-Sound hitSounds[HitSoundsCount];
-int currentHitSoundIndex;
+// Sounds, everything but the music goes through the mixer
+AudioMixer mixer;
+// When the mixer runs out of voices, screams take them over from hits
+const int hitPriority = 0;
+const int screamPriority = 1;
 
-const int ScreamSoundsCount = 4;
-Sound screamSounds[ScreamSoundsCount];
-int   screamSoundThresholds[ScreamSoundsCount];
-int   currentScreamIndex;
+MixerSample hitSamples[HitSoundsCount];
+// Screams are long, they're streamed from the files instead
+StreamingClip screamClips[ScreamSoundsCount];
 
 Music music;
 
 // ================
-// Game State
+// Platform State
 // ================
-Fox fox;
-FoxAnimationState foxAnimationState;
+// Menu panel and texts are static, so they're rendered once into
+// this texture, and again only when the screen size or the texts change
+RenderTexture2D menuOverlay;
+bool menuOverlayDirty = true;
 
-bool handGrabbed;
-bool foxHit;
+// Last drawn frame, see IsIdleFrame
+bool drawnMenuFrame;
+RenderState drawnRenderState;
 
-Vector3 pointerPosition;
-Vector3 previousPointerPos;
+CachedCamera camera;
 
-Vector3 handPosition;
-float handSpeed;
-Vector3 targetHandRotation;
-Vector3 currentHandRotation = handDefaultRotation;
+RenderQueue renderQueue;
 
-char resultText[256];
-int resultTextWidth;
+DynamicResolution sceneResolution;
+// Seconds the last drawn frame worked on the GPU, or on the CPU when GPU
+// isn't timed. Without waiting for vsync and the frame limiter
+float sceneFrameWork;
 
-bool isInMenu = true;
-bool isPatting;
+FrameProfiler profiler;
 
-Camera camera;
+// Times the render passes while the profiler is shown, or into a log
+GpuTimer gpuTimer;
 
-// ================
-// Operators
-// ================
-Vector3 operator+(Vector3 a, Vector3 b) {
-    return Vector3Add(a, b);
-}
+PointerSampler pointerSampler;
 
-Vector3 operator-(Vector3 a, Vector3 b) {
-    return Vector3Subtract(a, b);
-}
+// When enabled, hand is moved to the freshest pointer
+// position right before it's submitted for drawing
+bool lateLatchEnabled;
 
-Vector3 operator*(Vector3 v, float s) {
-    return {v.x * s, v.y * s, v.z * s};
-}
+// Age of the pointer position used for drawing the hand, in ms
+float simulatedHandLatency;
+float latchedHandLatency;
 
-Vector3 operator/(Vector3 v, float s) {
-    return {v.x / s, v.y / s, v.z / s};
-}
+// ================
+// Simulation Timing
+// ================
+// GetTime() of the last simulated step
+double simulationTime;
+// GetTime() of the last gathered frame input
+double frameInputTime;
+// GetTime() up to which the pointer was known at the last gathered
+// frame, steps are simulated up to it, see GatherFrameInput
+double pointerInputTime;
 
-Vector2 operator+(Vector2 a, Vector2 b) {
-    return Vector2Add(a, b);
-}
+bool pendingMousePressed;
+bool pendingMouseReleased;
 
-Vector2 operator-(Vector2 a, Vector2 b) {
-    return Vector2Subtract(a, b);
-}
+// Inputs of all steps simulated in the current frame
+ReplayFrame frameInput;
 
-Vector2 operator*(Vector2 v, float s) {
-    return {v.x * s, v.y * s};
-}
+ReplayFile replayRecorder;
+ReplayFile replayPlayer;
 
-Vector2 operator/(Vector2 v, float s) {
-    return {v.x / s, v.y / s};
-}
+// Game state is updated on its own thread, frames are drawn from
+// the newest snapshot of it
+SimulationThread simulation;
+const GameSnapshot* snapshot;
 
-Matrix operator*(Matrix a, Matrix b) {
-    return MatrixMultiply(a, b);
-}
+// Scream of the last hit, its volume follows the fox. Screams of the
+// hits before keep playing, with the volume they had at the reset
+MixerHandle screamHandle;
 
-// ================
-// Helper Functions 
-// ================
-
-// small hack, since it will work only for types that
-// can be compared to 0, typically numerical, but oh well
-// that's what I need
-template <typename T> 
-int sign(T val) {
-    return (0 < val) - (val < 0);
-}
-
-float RandomRange(float a, float b) {
-    float p = (float) rand() / (float) RAND_MAX;
-    return Lerp(a, b, p);
-}
-
-int RandomRange(int a, int b) {
-    float p = (float) rand() / (float) RAND_MAX;
-    return (int) (Lerp((float)a, (float)b, p) + 0.5f);
-}
+RenderState renderState;
+// Time to which the interpolated render state corresponds
+double renderStateTime;
 
 ////
 void UpdateDrawFrame();
+bool IsIdleFrame();
+void WaitIdleFrame();
 
-void UpdateMenu();
-void UpdateGame();
+void GatherFrameInput(ReplayFrame* frame);
+GameInput GetGameInput(Vector2 mousePosition);
+void HandleGameEvents();
 
+void UpdateMenuOverlay();
+void DrawMenuChrome(int width, int height);
 void DrawMenu();
 void DrawGame();
 
-void FoxAnimationRoutine(FoxAnimationState*);
+Matrix LateLatchHandTransform(Matrix transform, Vector3 handPos);
+void DrawHandLatency(int x, int y);
 
+void RunRenderBenchmark(int iterations);
 
-int main()
+
+int main(int argc, char** argv)
 {
-    InitWindow(screenWidth, screenHeight, "Spank The Fox");
-    InitAudioDevice();
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* gpuLogPath = NULL;
+    int benchmarkThousands = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--bench-render") == 0 && i + 1 < argc) {
+            benchmarkThousands = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--gpu-log") == 0 && i + 1 < argc) {
+            gpuLogPath = argv[++i];
+        }
+    }
 
-    handTexture = LoadTexture("assets/hand.png");
-    fox.texture = LoadTexture("assets/fox.png");
+    unsigned int seed = (unsigned int) time(NULL);
+    if(replayPath) {
+        if(OpenReplayPlayer(&replayPlayer, replayPath) == false) {
+            return 1;
+        }
 
-    srand((unsigned int) time(NULL));
+        seed = replayPlayer.header.seed;
+    }
 
-    char temp[128];
-    for(int i = 0; i < 3; i++) {
-        snprintf(temp, sizeof(temp), "assets/hit%d.mp3", i);
-        hitSounds[i] = LoadSound(temp);
+    if(recordPath && OpenReplayRecorder(&replayRecorder, recordPath, seed) == false) {
+        return 1;
     }
 
-    for(int i = 0; i < ScreamSoundsCount; i++) {
-        snprintf(temp, sizeof(temp), "assets/scream%d.wav", i);
-        screamSounds[i] = LoadSound(temp);
+    // Benchmark renders only offscreen, so the window isn't needed
+    if(benchmarkThousands > 0) {
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
     }
 
-    screamSoundThresholds[0] = 0;
-    screamSoundThresholds[1] = 100;
-    screamSoundThresholds[2] = 200;
-    screamSoundThresholds[3] = 350;
+    InitWindow(screenWidth, screenHeight, "Spank The Fox");
 
-    music = LoadMusicStream("assets/music.mp3");
+    InitGpuTimer(&gpuTimer);
+    if(gpuLogPath && (gpuTimer.supported == false || OpenGpuTimerLog(&gpuTimer, gpuLogPath) == false)) {
+        CloseWindow();
+        return 1;
+    }
+
+    renderQueue.gpuTimer = &gpuTimer;
+
+    int foxRegion = AddAtlasImage(&atlas, "assets/fox.png");
+    int handRegion = AddAtlasImage(&atlas, "assets/hand.png");
+    assert(foxRegion >= 0 && handRegion >= 0);
 
-    // Load and ensure that hand model was loaded succesfully,
-    // otherwise crash program. If we wouldn't check, next lines
-    // would buffer overflow what could cause unspecified behaviour
-    hand = LoadModel("assets/hand.obj");
-    assert(hand.meshCount == 1 && hand.materialCount == 1);
+    bool atlasBuilt = BuildAtlas(&atlas);
+    assert(atlasBuilt);
+    (void) atlasBuilt;
+    (void) handRegion;
 
-    handMesh = hand.meshes[0];
-    handMaterial = hand.materials[0];
+    foxSprite = atlas.regions[foxRegion].rect;
 
-    // There are some problems with loading .obj material file
-    // so we load and set texture manually 
-    handMaterial.maps[MATERIAL_MAP_DIFFUSE].texture = handTexture;
+    sdfFont = LoadSdfFont();
+
+    // Baked by mesh_optimizer, texcoords are moved into the atlas
+    bool handLoaded = LoadMeshFile("assets/hand.mesh", &handMesh, &handMaterial, &atlas);
+    assert(handLoaded);
+    (void) handLoaded;
 
     // Setup camera
-    camera.position = Vector3{ 2.0f, 1.0f, 6.0f };
-    camera.target = camera.position + Vector3{0, 0, -1};
-    camera.up = Vector3{ 0.0f, 1.0f, 0.0f };
+    Camera view = {};
+    view.position = cameraPosition;
+    view.target = view.position + Vector3{0, 0, -1};
+    view.up = Vector3{ 0.0f, 1.0f, 0.0f };
+
+    view.fovy = 60.0f;
+    view.projection = CAMERA_PERSPECTIVE;
+
+    SetCameraView(&camera, view);
+    SetCameraViewport(&camera, GetScreenWidth(), GetScreenHeight());
+
+    // Scenery
+    gridMesh = LoadGridMesh(15, 15);
 
-    camera.fovy = 60.0f;
-    camera.projection = CAMERA_PERSPECTIVE;
+    InitDynamicResolution(&sceneResolution, minResolutionScale, maxResolutionScale);
 
     // Prepare game state
-    fox.position = foxStartPosition;
-    handPosition = handDefaultPosition;
+    SeedRandom(seed);
+    InitGame();
 
-    Vector3 min = Vector3{1, 1, 1} * -foxScale / 2 + foxStartPosition;
-    Vector3 max = Vector3{1, 1, 1} *  foxScale / 2 + foxStartPosition;
-    fox.bounds  = { min, max };
+    renderState = CaptureRenderState();
+
+    if(benchmarkThousands > 0) {
+        RunRenderBenchmark(benchmarkThousands * 1000);
+
+        CloseWindow();
+        return 0;
+    }
+
+    InitAudioDevice();
+
+    SetAudioStreamBufferSizeDefault(mixerBufferFrames);
+    InitAudioMixer(&mixer, mixerSampleRate);
+
+    char temp[128];
+    for(int i = 0; i < HitSoundsCount; i++) {
+        snprintf(temp, sizeof(temp), "assets/hit%d.mp3", i);
+        LoadMixerSample(&hitSamples[i], temp, mixer.sampleRate);
+    }
+
+    for(int i = 0; i < ScreamSoundsCount; i++) {
+        // Transcoded by audio_transcoder, the original WAV still works
+        snprintf(temp, sizeof(temp), "assets/scream%d.qoa", i);
+        if(FileExists(temp) == false) {
+            snprintf(temp, sizeof(temp), "assets/scream%d.wav", i);
+        }
+        LoadStreamingClip(&screamClips[i], temp);
+    }
+
+
+    SetAudioStreamBufferSizeDefault(musicBufferFrames);
+    music = LoadMusicStream("assets/music.mp3");
 
     PlayMusicStream(music);
 
-    /// 
+    StartPointerSampler(&pointerSampler);
+    simulationTime = GetTime();
+    frameInputTime = simulationTime;
+    pointerInputTime = simulationTime;
+
+    StartSimulationThread(&simulation, simulationTime);
+    snapshot = AcquireSnapshot(&simulation);
+
+    ///
     // Main Loop
     ///
 
 #if WEB_BUILD
     emscripten_set_main_loop(UpdateDrawFrame, 0, 1);
 #else
-    SetTargetFPS(60);
+    SetTargetFPS(targetFPS);
     while(WindowShouldClose() == false) {
         UpdateDrawFrame();
     }
 #endif
 
+    StopSimulationThread(&simulation);
+    StopPointerSampler(&pointerSampler);
+
+    CloseGpuTimer(&gpuTimer);
+
+    CloseAudioMixer(&mixer);
+    for(int i = 0; i < HitSoundsCount; i++) {
+        UnloadMixerSample(&hitSamples[i]);
+    }
+    for(int i = 0; i < ScreamSoundsCount; i++) {
+        UnloadStreamingClip(&screamClips[i]);
+    }
+
+    CloseReplay(&replayRecorder);
+    CloseReplay(&replayPlayer);
+
     CloseWindow();
     return 0;
 }
 
 void UpdateDrawFrame()
 {
+    ProfilerBeginFrame(&profiler);
+
+    if(IsKeyPressed(profilerToggleKey)) {
+        profiler.visible = !profiler.visible;
+    }
+
+    // Without a sampler between the frames, there's nothing newer to latch
+    if(IsKeyPressed(lateLatchToggleKey) && pointerSampler.async) {
+        lateLatchEnabled = !lateLatchEnabled;
+    }
+
     // Update
+    ProfilerBeginPhase(&profiler);
     UpdateMusicStream(music);
+    UpdateAudioMixer(&mixer);
+    ProfilerEndPhase(&profiler, PROFILER_PHASE_MUSIC);
+
+    ProfilerBeginPhase(&profiler);
 
-    if(isInMenu) {
-        UpdateMenu();
+    // Render in between the last two simulation steps. Replayed
+    // frames don't know the original timing, so they show the last one
+    float alpha = 1;
+
+    bool isReplaying = replayPlayer.file != NULL;
+    if(isReplaying && ReadReplayFrame(&replayPlayer, &frameInput) == false) {
+        printf("Replay finished after %lld frames\n", replayPlayer.frameIndex);
+        CloseReplay(&replayPlayer);
+
+        // Continue live from here
+        isReplaying = false;
+        simulationTime = GetTime();
     }
-    else {
-        UpdateGame();
+
+    if(isReplaying == false) {
+        GatherFrameInput(&frameInput);
+    }
+
+    // Steps run on the simulation thread, meanwhile this
+    // frame draws the newest snapshot that's finished
+    PushSimulationFrame(&simulation, &frameInput, simulationTime, pointerInputTime);
+
+    if(replayRecorder.file) {
+        WriteReplayFrame(&replayRecorder, &frameInput);
+    }
+
+    snapshot = AcquireSnapshot(&simulation);
+
+    HandleGameEvents();
+
+    // Snapshot is usually the previous frame's, the simulation is busy
+    // with this one. Interpolating to the time that frame's input was
+    // gathered, not to now, shows every frame the same delay behind
+    if(isReplaying == false) {
+        alpha = (float) ((snapshot->inputTime - snapshot->time) / simulationDeltaTime);
+        alpha = Clamp(alpha, 0, 1);
+    }
+
+    renderState = InterpolateRenderState(snapshot->previous, snapshot->current, alpha);
+    renderStateTime = snapshot->time - (1 - alpha) * simulationDeltaTime;
+
+    ProfilerEndPhase(&profiler, PROFILER_PHASE_UPDATE);
+
+    // Nothing to draw, screen keeps showing the last frame
+    if(IsIdleFrame()) {
+        WaitIdleFrame();
+        PauseDynamicResolution(&sceneResolution);
+        return;
     }
 
     // Rendering
+    ProfilerBeginPhase(&profiler);
+
+    // Dynamic resolution needs only the total, which costs two timestamps,
+    // passes flush the batch at every change
+    gpuTimer.timePasses = profiler.visible || gpuTimer.log != NULL;
+    gpuTimer.enabled = gpuTimer.timePasses || sceneResolution.enabled;
+    GpuTimerBeginFrame(&gpuTimer);
+
+    // Has to happen outside of BeginDrawing, it switches render targets
+    if(snapshot->isInMenu) {
+        UpdateMenuOverlay();
+    }
+
+    UpdateDynamicResolution(&sceneResolution, sceneFrameWork, 1.0f / targetFPS);
+
     BeginDrawing();
-    ClearBackground({219, 216, 225, 0});
+    ClearBackground(backgroundColor);
     // ClearBackground({242, 159, 203, 0});
     // ClearBackground(LIGHTGRAY);
 
-    if(isInMenu) {
+    if(snapshot->isInMenu) {
         DrawMenu();
     }
     else {
         DrawGame();
     }
 
-    // DrawFPS(0, 0);
+    drawnMenuFrame = snapshot->isInMenu && profiler.visible == false;
+    drawnRenderState = renderState;
+
+    GpuTimerEndFrame(&gpuTimer);
+
+    ProfilerEndPhase(&profiler, PROFILER_PHASE_DRAW);
 
+    // GPU result is a few frames old, that's fine for the resolution. CPU
+    // time doesn't go down with it, so it's used only when there's nothing else
+    if(gpuTimer.supported) {
+        sceneFrameWork = gpuTimer.last[gpuTimerTotalRow] / 1000;
+    }
+    else {
+        sceneFrameWork = (profiler.current[PROFILER_PHASE_MUSIC] + profiler.current[PROFILER_PHASE_UPDATE] +
+                          profiler.current[PROFILER_PHASE_DRAW]) / 1000;
+    }
+
+    // Overlay itself isn't part of any measured phase
+    if(profiler.visible) {
+        DrawProfiler(&profiler, 10, 10);
+        DrawGpuTimer(&gpuTimer, 640, 10);
+        DrawHandLatency(10, screenHeight - 30);
+        DrawText(TextFormat("Scene resolution: %dx%d", sceneResolution.width, sceneResolution.height),
+                 10, screenHeight - 55, 20, BLACK);
+    }
+
+    // EndDrawing swaps buffers and waits for the target framerate
+    ProfilerBeginPhase(&profiler);
     EndDrawing();
+    ProfilerEndPhase(&profiler, PROFILER_PHASE_END_DRAWING);
+
+    MarkPointerPolled(&pointerSampler);
 }
 
-void UpdateMenu() {
-    FoxAnimationRoutine(&foxAnimationState);
+// Menu frame that would look exactly like the last drawn one. Only the
+// fox moves in the menu, and it stands still most of the time
+bool IsIdleFrame() {
+#if WEB_BUILD
+    // Browser schedules the frames, there's no waiting in them
+    return false;
+#else
+    if(snapshot->isInMenu == false || drawnMenuFrame == false || profiler.visible) {
+        return false;
+    }
 
-    if(IsMouseButtonPressed(0)) {
-        isInMenu = false;
+    // Replays run as fast as they're drawn
+    if(replayPlayer.file || menuOverlayDirty || snapshot->foxJumpDelay == 0) {
+        return false;
     }
+
+    return memcmp(&renderState, &drawnRenderState, sizeof(RenderState)) == 0;
+#endif
 }
 
-void UpdateGame() {
-    // Create ray from cursor point, using current camera
-    Ray ray = GetMouseRay(GetMousePosition(), camera);
+// Sleeps instead of EndDrawing, until the fox jumps again, or for one
+// idle frame. There's no swap, so the input has to be polled here
+void WaitIdleFrame() {
+    double wait = idleFrameTime;
 
-    // Find distance on the ray, on which, the Z coordinate is 0.
-    // In the other words, cast ray on the 2D plane XY
-    float dist = -ray.position.z / ray.direction.z;
-    pointerPosition = ray.position + ray.direction * dist;
+    double jumpTime = snapshot->time + snapshot->foxJumpDelay;
+    double untilJump = jumpTime - GetTime();
+    if(untilJump < wait) {
+        wait = untilJump;
+    }
 
-    if(handGrabbed == false) {
-        handPosition = Vector3Lerp(handPosition, handDefaultPosition, GetFrameTime() * 4);
-        targetHandRotation = handDefaultRotation;
+    if(wait > 0) {
+        WaitTime(wait);
+    }
 
-        if(IsMouseButtonPressed(0)) {
-            handGrabbed = true;
+    PollInputEvents();
+    MarkPointerPolled(&pointerSampler);
+}
 
-            HideCursor();
-        }
+// Advances simulation clock and prepares inputs of all steps
+// that should be simulated in this frame
+void GatherFrameInput(ReplayFrame* frame) {
+    // Button edges are kept until some simulation step consumes them,
+    // rendering may be faster than the simulation
+    pendingMousePressed  = pendingMousePressed  || IsMouseButtonPressed(0);
+    pendingMouseReleased = pendingMouseReleased || IsMouseButtonReleased(0);
+
+    UpdatePointerSampler(&pointerSampler);
+
+    // Not GetFrameTime, it's updated only by frames that are drawn
+    double now = GetTime();
+    frame->frameDelta = (float) (now - frameInputTime);
+    frameInputTime = now;
+
+    frame->mousePosition = GetMousePosition();
+    frame->mousePressed = false;
+    frame->mouseReleased = false;
+
+    // Only up to the newest pointer sample, a sampler period behind now,
+    // or a frame without one. Otherwise speed of the last step would
+    // depend on when the frame and the samples happened to come
+    pointerInputTime = GetPointerTrackTime(&pointerSampler.track, now);
+
+    if(pointerInputTime - simulationTime > maxSimulationSteps * simulationDeltaTime) {
+        simulationTime = pointerInputTime - maxSimulationSteps * simulationDeltaTime;
     }
-    else if(foxHit == false) {
-        FoxAnimationRoutine(&foxAnimationState);
 
-        // cheat for testing maximum possible speed
-        // if(IsMouseButtonPressed(1)) {
-        //     ray = GetMouseRay({screenWidth, screenHeight}, camera);
-        //     dist = -ray.position.z / ray.direction.z;
-        //     previousPointerPos = ray.position + ray.direction * dist;
+    frame->stepCount = 0;
+    if(pointerInputTime > simulationTime) {
+        frame->stepCount = (int) ((pointerInputTime - simulationTime) / simulationDeltaTime);
+    }
 
+    for(int i = 0; i < frame->stepCount; i++) {
+        simulationTime += simulationDeltaTime;
 
-        //     ray = GetMouseRay({0, 0}, camera);
-        //     dist = -ray.position.z / ray.direction.z;
-        //     pointerPosition = ray.position + ray.direction * dist;
-        // }
+        // Every step gets the pointer position at its own time, so the
+        // measured speed follows the swing, not the rendering framerate
+        Vector2 stepMousePosition = GetTrackPosition(&pointerSampler.track, simulationTime);
+        GameInput* input = &frame->steps[i];
+        *input = GetGameInput(stepMousePosition);
 
-        // Calculate speed of the pointer in the World coordinates
-        Vector3 delta = pointerPosition - previousPointerPos;
-        Vector3 velocity = delta / GetFrameTime();
-        handSpeed = Vector3Length(delta) / GetFrameTime() * -sign(delta.x);
+        if(i == 0) {
+            input->mousePressed  = pendingMousePressed;
+            input->mouseReleased = pendingMouseReleased;
 
-        handPosition = pointerPosition;
+            frame->mousePressed  = pendingMousePressed;
+            frame->mouseReleased = pendingMouseReleased;
 
-        // Calculate target hand rotation using direction from the camera, 
-        // it's used so the hand is rotated away from our view
-        // should look better
-        float rayAngle = atan2f(ray.direction.z, ray.direction.x) + PI / 2.0f;
-        targetHandRotation.y = velocity.x * handRotationFactor - rayAngle;
+            pendingMousePressed  = false;
+            pendingMouseReleased = false;
+        }
+    }
+}
 
-        // Actual logic that handles hitting
-        if(isPatting == false && handPosition.x < fox.position.x && handSpeed > minHitSpeed) {
-            snprintf(resultText, sizeof(resultText), "YOU SPANKED THE FOX AT\n%d KILOMETERS PER HOUR", (int) handSpeed);
-            resultTextWidth = MeasureText(resultText, fontSize);
+GameInput GetGameInput(Vector2 mousePosition) {
+    GameInput input = {};
 
-            foxHit = true;
+    // Cast ray from cursor point on the 2D plane XY, using current camera
+    input.pointerPosition = GetCameraPlanePoint(&camera, mousePosition, &input.pointerDirection);
 
-            currentHitSoundIndex = rand() % HitSoundsCount;
-            PlaySound(hitSounds[currentHitSoundIndex]);
+    return input;
+}
 
-            currentScreamIndex = ScreamSoundsCount - 1;
-            for(int i = 0; i < ScreamSoundsCount - 1; i++) {
-                if(handSpeed >= screamSoundThresholds[i] && handSpeed < screamSoundThresholds[i + 1]) {
-                    currentScreamIndex = i;
-                    break;
-                }
-            }
+void HandleGameEvents() {
+    GameEventMessage message;
+    while(PopGameEvents(&simulation, &message)) {
+        GameEvents* events = &message.events;
 
-            // small pitch variation to hide a little repetiveness
-            // of the screams
-            float r = RandomRange(-pitchVariation, pitchVariation);
-            float pitch  = 1 + r;
+        if(events->handGrabbed) {
+            HideCursor();
+        }
 
-            SetSoundPitch(screamSounds[currentScreamIndex], pitch);
-            PlaySound(screamSounds[currentScreamIndex]);
+        if(events->foxHit) {
+            PlayMixerSample(&mixer, &hitSamples[message.hitSoundIndex], hitPriority, 1, 1, 0);
+            screamHandle = PlayMixerClip(&mixer, &screamClips[message.screamIndex], screamPriority,
+                                         snapshot->screamVolume, message.screamPitch, 0);
 
             StopMusicStream(music);
+        }
 
-            fox.velocity = velocity;
+        if(events->gameReset) {
+            screamHandle = {};
+            PlayMusicStream(music);
         }
 
+        if(events->handReleased) {
+            ShowCursor();
+        }
+    }
 
-        bool isInBounds = handPosition.x > fox.bounds.min.x && handPosition.x < fox.bounds.max.x &&
-                          handPosition.y > fox.bounds.min.y && handPosition.y < fox.bounds.max.y; 
+    if(snapshot->foxHit) {
+        SetMixerSoundGain(&mixer, screamHandle, snapshot->screamVolume);
+    }
+}
 
-        if(handPosition.x < fox.bounds.max.x && handSpeed < minHitSpeed) {
-            if(isInBounds)
-            {
-                isPatting = true;
+// Re-renders the menu overlay if it's outdated. Texts changing,
+// e.g. with language, have to set menuOverlayDirty
+void UpdateMenuOverlay() {
+    int width = GetScreenWidth();
+    int height = GetScreenHeight();
 
-                targetHandRotation.x = 30 * DEG2RAD;
-                targetHandRotation.z = 180 * DEG2RAD;
-            }
-        }
-        
-        if(isPatting && isInBounds == false) {
-            isPatting = false;
+    if(menuOverlay.id != 0 && (menuOverlay.texture.width != width || menuOverlay.texture.height != height)) {
+        UnloadRenderTexture(menuOverlay);
+        menuOverlay = {};
+    }
 
-            // targetHandRotation.x = 0;
-            // targetHandRotation.z = 90 * DEG2RAD;
-            targetHandRotation = handDefaultRotation;
-        }
+    if(menuOverlay.id == 0) {
+        menuOverlay = LoadRenderTexture(width, height);
+        menuOverlayDirty = true;
     }
 
-    if(foxHit) {
-        // simple kinematic equations calculating fox velocity and positions.
-        // Those are:
-        // V = V0 + 1/2 * a * t
-        // S = S0 + V * t
-        // where:
-        // V = velocity
-        // a = acceleration (in this case gravity)
-        // t = time interval
-        // S = position
-        // They are here because at some point I wanted for camera to track the Fox
-        // but it was cut out to save "development" time
-        // 
-        // now it's used for sound attenuation
-        fox.velocity = fox.velocity + Vector3{0, 0.5f * gravity * GetFrameTime(), 0};
-        fox.position = fox.position + fox.velocity * GetFrameTime();
-
-        // Sound attenuation mentioned earlier. It uses simple 1 / x function
-        // multiplied by found factor to "feel" better
-        float distFromCenter = Vector3Length(fox.position);
-        float volume = attenuationFactor / distFromCenter;
-        // Clamp sound volume so it never exceeds 1.
-        volume = volume > 1 ? 1 : volume;
-        SetSoundVolume(screamSounds[currentScreamIndex], volume);
-
-        // Last minute change, when after hit, the hand also move
-        // since it's last minute, I don't store actual hand velocity
-        // and just usuning fox velocity
-        // Since it's on the screen for fraction of a second it's 
-        // "good enough"
-        handPosition = handPosition + fox.velocity * GetFrameTime();
-    }
-
-    // Reset Game State
-    if(foxHit && IsMouseButtonPressed(0)) {
-        foxHit = false;
-        handSpeed = 0;
-        resultText[0] = '\0';
-
-        fox.position = foxStartPosition;
-        fox.velocity = {0, 0, 0};
-
-        StopSound(screamSounds[currentScreamIndex]);
-        StopSound(hitSounds[currentHitSoundIndex]);
-        PlayMusicStream(music);
-    }
-
-    if(IsMouseButtonReleased(0)) {
-        handGrabbed = false;
-        isPatting = false;
-
-        targetHandRotation = handDefaultRotation;
-
-        ShowCursor();
-    }
-
-    // calculate hand roation. Here I use very simple damping methos using Lerp function to give it
-    // less jerky movement. Wraning! This method is not framerate-independent, even if you multiply
-    // the factor by frame time. It's also unstable in certain situations
-    // check: https://theorangeduck.com/page/spring-roll-call
-    currentHandRotation = Vector3Lerp(currentHandRotation, targetHandRotation, GetFrameTime() * handDampFactor);
-
-    // Clamp Y rotation to 90 degrees
-    currentHandRotation.y = fminf(currentHandRotation.y, PI / 2);
-
-    previousPointerPos = pointerPosition;
+    if(menuOverlayDirty == false) {
+        return;
+    }
+
+    BeginTextureMode(menuOverlay);
+    ClearBackground({0, 0, 0, 0});
+    DrawMenuChrome(width, height);
+    EndTextureMode();
+
+    menuOverlayDirty = false;
 }
 
 void DrawMenu() {
     DrawGame();
 
+    // Render texture is upside down
+    Rectangle source = { 0, 0, (float) menuOverlay.texture.width, (float) -menuOverlay.texture.height };
+    DrawTextureRec(menuOverlay.texture, source, {0, 0}, WHITE);
+}
+
+void DrawMenuChrome(int width, int height) {
     // Pretty much eyeballing the values here so most of them aren't in the config
-    Vector2 screenCenter = Vector2{screenWidth, screenHeight} / 2;
+    Vector2 screenCenter = Vector2{(float) width, (float) height} / 2;
 
-    int w = MeasureText(titleText, titleSize);
-    DrawText(titleText, (int) screenCenter.x - w / 2, 20, titleSize, BLACK);
+    // Title is over the empty texture, its color is written as is, and
+    // only its alpha is blended, so the smooth edges don't get thinner
+    rlSetBlendFactors(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM);
+    int w = MeasureSdfText(sdfFont, titleText, titleSize);
+    DrawSdfText(sdfFont, titleText, (int) screenCenter.x - w / 2, 20, titleSize, BLACK);
+    EndBlendMode();
 
     w = MeasureText(warningText, warningSize);
     DrawText(warningText, (int) screenCenter.x - w / 2, 190, warningSize, DARKGRAY);
 
     Vector2 rectPos = screenCenter - menuRectSize / 2 + menuRectOffset;
     Vector2 rectCenter = rectPos + menuRectSize / 2;
+
+    // Panel is translucent, blending it over the empty texture would square
+    // its alpha. Written as is, it blends over the game the same as before
+    rlSetBlendFactors(GL_ONE, GL_ZERO, GL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM);
     DrawRectangleV(rectPos, menuRectSize, {0, 0, 0, 127});
+    EndBlendMode();
 
     w = MeasureText(creditsLabelText, creditsLabelSize);
     DrawText(creditsLabelText, (int) rectCenter.x - w / 2, (int) rectPos.y + 10, creditsLabelSize, LIGHTGRAY);
@@ -517,64 +709,193 @@ void DrawMenu() {
 }
 
 void DrawGame() {
-    BeginMode3D(camera);
+    ClearRenderQueue(&renderQueue, &camera.camera);
 
-    // Disable writing to depth buffer, so grid and fox quad 
-    // won't render above the hand
-    rlDisableDepthMask();
+    // Grid and fox quad are in the background layer and don't write
+    // depth, so they never render above the hand, even where it
+    // goes behind the fox
+    SubmitStaticMesh(&renderQueue, RENDER_LAYER_BACKGROUND, false, &gridMesh, MatrixIdentity());
+    SubmitBillboard(&renderQueue, RENDER_LAYER_BACKGROUND, atlas.texture, foxSprite, renderState.foxPosition, foxScale, WHITE);
 
-    DrawGrid(15, 15);
-    DrawBillboard(camera, fox.texture, fox.position, foxScale, WHITE);
+    Matrix handTransform = MatrixScale(handScale, handScale, handScale);
 
-    // DrawBoundingBox(fox.bounds, RED);
+    handTransform = handTransform *
+                    MatrixTranslate(0, 0, -1.2f) * // Move pivot to the beginning of the hand
+                    MatrixRotateXYZ(renderState.handRotation);
 
-    // DrawGrid and DrawBillboard is batched, so we have to flush it before
-    // rendering hand model to get proper draw order
-    rlDrawRenderBatchActive();
+    Vector3 handPos = renderState.handPosition;
+    handTransform = handTransform * MatrixTranslate(handPos.x, handPos.y, handPos.z);
 
-    // Enable depth buffer again so the hand renders correctly
-    rlEnableDepthMask();
+    // Hand follows the pointer only while it's grabbed before the hit
+    if(snapshot->handFollowsPointer) {
+        float latency = (float) ((GetTime() - renderStateTime) * 1000);
+        simulatedHandLatency = Lerp(simulatedHandLatency, latency, latencyAverageFactor);
 
-    Matrix handTransform = MatrixScale(handScale, handScale, handScale);
-    
-    handTransform = handTransform * 
-                    MatrixTranslate(0, 0, -1.2f) * // Move pivot to the beginning of the hand
-                    MatrixRotateXYZ(currentHandRotation);
+        if(lateLatchEnabled) {
+            handTransform = LateLatchHandTransform(handTransform, handPos);
+        }
+    }
 
-    handTransform = handTransform * MatrixTranslate(handPosition.x, handPosition.y, handPosition.z);
+    SubmitMesh(&renderQueue, RENDER_LAYER_WORLD, true, &handMesh, &handMaterial, handTransform);
 
-    DrawMesh(handMesh, handMaterial, handTransform);
+    // Measuring is a lookup in the layout cache
+    const char* text = snapshot->resultText;
+    int textWidth = MeasureSdfText(sdfFont, text, fontSize);
+    SubmitText(&renderQueue, RENDER_LAYER_UI, sdfFont, text,
+               (screenWidth - textWidth) / 2, screenHeight / 2 - 70, fontSize, BLACK);
 
-    EndMode3D();
+    if(sceneResolution.enabled == false) {
+        DrawRenderQueue(&renderQueue, &camera);
+        return;
+    }
 
-    DrawText(resultText, (screenWidth - resultTextWidth) / 2, screenHeight / 2 - 70, fontSize, BLACK);
+    // 3D layers in the scaled resolution, UI over them in the full one
+    SortRenderQueue(&renderQueue);
+
+    BeginDynamicResolution(&sceneResolution, backgroundColor);
+    DrawRenderLayers(&renderQueue, &camera, RENDER_LAYER_BACKGROUND, RENDER_LAYER_WORLD);
+    EndDynamicResolution(&sceneResolution);
+
+    DrawRenderLayers(&renderQueue, &camera, RENDER_LAYER_UI, RENDER_LAYER_UI);
 }
 
-// Coroutine style animation routine
-void FoxAnimationRoutine(FoxAnimationState* data) {
-    if(data->isJumping == false) {
-        if(isPatting) {
-            return;
-        }
+// Re-reads the pointer and moves the hand to it, as late as possible before
+// it's drawn, so it lags behind the cursor less than the simulated position.
+// Only takes what the sampler already has, the simulation sees the same
+// track whether this runs or not
+Matrix LateLatchHandTransform(Matrix transform, Vector3 handPos) {
+    DrainPointerQueue(&pointerSampler);
 
-        data->time += GetFrameTime();
-        if(data->time >= data->waitTime) {
-            data->isJumping = true;
-            data->time = 0;
+    PointerSample* latest = GetLatestPointerSample(&pointerSampler);
+    if(latest == NULL) {
+        return transform;
+    }
 
-            data->jumps = RandomRange(jumpsMin, jumpsMax);
-        }
+    Vector3 latchedPos = GetGameInput(latest->position).pointerPosition;
+
+    // Translation to the hand position is the last one in the chain,
+    // so it's enough to shift the translation part of the matrix
+    transform.m12 += latchedPos.x - handPos.x;
+    transform.m13 += latchedPos.y - handPos.y;
+    transform.m14 += latchedPos.z - handPos.z;
+
+    // Age of the position since the sampler read it. While the pointer
+    // stands still there's nothing new to latch, so that isn't measured
+    if(latest == GetTrackSample(&pointerSampler.track, pointerSampler.track.count - 1)) {
+        float latency = (float) ((GetTime() - latest->time) * 1000);
+        latchedHandLatency = Lerp(latchedHandLatency, latency, latencyAverageFactor);
+    }
+
+    return transform;
+}
+
+void DrawHandLatency(int x, int y) {
+    const char* text;
+    if(pointerSampler.async == false) {
+        text = TextFormat("Hand input age: %.1f ms simulated, late-latch unavailable", simulatedHandLatency);
+    }
+    else if(lateLatchEnabled) {
+        text = TextFormat("Hand input age: %.1f ms late-latched, %.1f ms simulated (F4)",
+                          latchedHandLatency, simulatedHandLatency);
     }
     else {
-        data->time += GetFrameTime();
+        text = TextFormat("Hand input age: %.1f ms simulated, late-latch off (F4)", simulatedHandLatency);
+    }
+
+    DrawText(text, x, y, 20, BLACK);
+}
+
+// ================
+// Render Benchmark
+// ================
+
+// Renders the menu and the game with fixed state into an offscreen
+// target, many times, and reports how long it takes. CPU submit time
+// is measured per iteration, up to the point when all draw calls are
+// issued. Total time is the wall time of all iterations, including
+// waiting for the GPU to finish, divided by the iteration count.
+void RunRenderBenchmark(int iterations) {
+    const int warmupIterations = 100;
+
+    RenderTexture2D target = LoadRenderTexture(screenWidth, screenHeight);
+    float* submitTimes = (float*) malloc(iterations * sizeof(float));
+
+    const char* sceneNames[] = { "menu", "game" };
+
+    // Measures the full resolution, and the scene target
+    // can't be used while drawing into another one
+    sceneResolution.enabled = false;
+
+    printf("Render benchmark, %d iterations per scene, %dx%d\n", iterations, screenWidth, screenHeight);
+
+    // Simulation isn't running, frames are drawn from this one
+    GameSnapshot benchmarkSnapshot = {};
+    snapshot = &benchmarkSnapshot;
+
+    for(int scene = 0; scene < 2; scene++) {
+        // Fixed camera and hand state. Game scene shows the result,
+        // so there is the most text and the hand isn't late latched
+        benchmarkSnapshot.isInMenu = scene == 0;
+        benchmarkSnapshot.foxHit = scene == 1;
+        renderState.foxPosition = foxStartPosition + Vector3{0, foxJumpHeight / 2, 0};
+        renderState.handPosition = scene == 0 ? handDefaultPosition : Vector3{-1.0f, 1.5f, 0};
+        renderState.handRotation = handDefaultRotation;
+
+        char* text = benchmarkSnapshot.resultText;
+        text[0] = '\0';
+        if(scene == 1) {
+            snprintf(text, sizeof(benchmarkSnapshot.resultText), "YOU SPANKED THE FOX AT\n%d KILOMETERS PER HOUR", 123);
+        }
+
+        // Menu overlay is cached, same as in the game loop
+        if(benchmarkSnapshot.isInMenu) {
+            UpdateMenuOverlay();
+        }
+
+        double start = 0;
+        for(int i = -warmupIterations; i < iterations; i++) {
+            if(i == 0) {
+                // Drain the warmup work before measuring
+                UnloadImage(LoadImageFromTexture(target.texture));
+                start = GetTime();
+            }
 
-        fox.position.y = foxStartPosition.y + foxJumpHeight * fabsf(sinf(data->time * PI / foxJumpTime));
+            double submitStart = GetTime();
 
-        if(data->time >= data->jumps * foxJumpTime) {
-            data->isJumping = false;
-            data->time = 0;
+            BeginTextureMode(target);
+            ClearBackground(backgroundColor);
 
-            data->waitTime = RandomRange(jumpTimeMin, jumpTimeMax);
+            if(benchmarkSnapshot.isInMenu) {
+                DrawMenu();
+            }
+            else {
+                DrawGame();
+            }
+
+            // Flushes the batch, so all draw calls are issued
+            EndTextureMode();
+
+            if(i >= 0) {
+                submitTimes[i] = (float) ((GetTime() - submitStart) * 1000);
+            }
+        }
+
+        // Reading the target back waits until the GPU is done
+        UnloadImage(LoadImageFromTexture(target.texture));
+        double total = (GetTime() - start) * 1000 / iterations;
+
+        qsort(submitTimes, iterations, sizeof(float), CompareFloats);
+
+        double sum = 0;
+        for(int i = 0; i < iterations; i++) {
+            sum += submitTimes[i];
         }
+
+        printf("%-5s submit avg %.4f ms, p50 %.4f ms, p99 %.4f ms, max %.4f ms | frame %.4f ms\n",
+               sceneNames[scene], sum / iterations, submitTimes[iterations / 2],
+               submitTimes[(iterations - 1) * 99 / 100], submitTimes[iterations - 1], total);
     }
-}
\ No newline at end of file
+
+    free(submitTimes);
+    UnloadRenderTexture(target);
+}
@@ -0,0 +1,203 @@
+// Loading of baked meshes, see mesh_file.h. The file is memory mapped,
+// the arrays are given to UploadMesh right where they are, and the
+// mapping is closed once the data is on the GPU. On the web there's
+// no mapping, the file is read from the preloaded virtual file system.
+//
+// When the mesh texture is in the given atlas, texcoords are moved into
+// its region and the material uses the atlas texture instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if WEB_BUILD
+// LoadFileData only
+#elif defined(_WIN32)
+#include "win32.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "include/raylib.h"
+
+#include "mesh_file.h"
+
+struct MappedFile {
+    const unsigned char* data;
+    size_t size;
+
+#if !WEB_BUILD && defined(_WIN32)
+    void* file;
+    void* mapping;
+#endif
+};
+
+bool MapFile(MappedFile* mapped, const char* path) {
+    memset(mapped, 0, sizeof(*mapped));
+
+#if WEB_BUILD
+    unsigned int size = 0;
+    mapped->data = LoadFileData(path, &size);
+    mapped->size = size;
+#elif defined(_WIN32)
+    mapped->file = CreateFileA(path, WIN32_GENERIC_READ, WIN32_FILE_SHARE_READ, NULL,
+                               WIN32_OPEN_EXISTING, WIN32_FILE_ATTRIBUTE_NORMAL, NULL);
+    if(mapped->file == WIN32_INVALID_HANDLE_VALUE) {
+        mapped->file = NULL;
+        return false;
+    }
+
+    mapped->size = GetFileSize(mapped->file, NULL);
+    mapped->mapping = CreateFileMappingA(mapped->file, NULL, WIN32_PAGE_READONLY, 0, 0, NULL);
+    if(mapped->mapping) {
+        mapped->data = (const unsigned char*) MapViewOfFile(mapped->mapping, WIN32_FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    int file = open(path, O_RDONLY);
+    if(file < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(file, &info) == 0 && info.st_size > 0) {
+        void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(data != MAP_FAILED) {
+            mapped->data = (const unsigned char*) data;
+            mapped->size = info.st_size;
+        }
+    }
+
+    // Mapping stays valid after the file is closed
+    close(file);
+#endif
+
+    return mapped->data != NULL;
+}
+
+void UnmapFile(MappedFile* mapped) {
+#if WEB_BUILD
+    UnloadFileData((unsigned char*) mapped->data);
+#elif defined(_WIN32)
+    if(mapped->data) {
+        UnmapViewOfFile(mapped->data);
+    }
+    if(mapped->mapping) {
+        CloseHandle(mapped->mapping);
+    }
+    if(mapped->file) {
+        CloseHandle(mapped->file);
+    }
+#else
+    if(mapped->data) {
+        munmap((void*) mapped->data, mapped->size);
+    }
+#endif
+
+    memset(mapped, 0, sizeof(*mapped));
+}
+
+bool IsArrayInFile(const MappedFile* mapped, uint32_t offset, uint32_t count, uint32_t elementSize) {
+    return offset % meshFileAlignment == 0 && offset <= mapped->size &&
+           (uint64_t) count * elementSize <= mapped->size - offset;
+}
+
+// Uploads the mesh to the GPU and loads its material, with the texture
+// taken from the atlas when it's there. Atlas can be NULL
+bool LoadMeshFile(const char* path, Mesh* mesh, Material* material, const TextureAtlas* atlas) {
+    MappedFile mapped;
+    if(MapFile(&mapped, path) == false) {
+        printf("Failed to open mesh %s\n", path);
+        return false;
+    }
+
+    const MeshFileHeader* header = (const MeshFileHeader*) mapped.data;
+
+    bool valid = mapped.size >= sizeof(MeshFileHeader) &&
+                 memcmp(header->magic, meshFileMagic, sizeof(meshFileMagic)) == 0;
+
+    if(valid == false) {
+        printf("%s is not a mesh file\n", path);
+    }
+    else if(header->version != meshFileVersion) {
+        printf("Mesh %s has version %u, expected %u\n", path, header->version, meshFileVersion);
+        valid = false;
+    }
+    else if(IsArrayInFile(&mapped, header->positionsOffset, header->vertexCount, 3 * sizeof(float)) == false ||
+            IsArrayInFile(&mapped, header->texcoordsOffset, header->vertexCount, 2 * sizeof(float)) == false ||
+            IsArrayInFile(&mapped, header->normalsOffset, header->vertexCount, 3 * sizeof(float)) == false ||
+            IsArrayInFile(&mapped, header->indicesOffset, header->indexCount, sizeof(uint16_t)) == false) {
+        printf("Mesh %s is truncated\n", path);
+        valid = false;
+    }
+
+    if(valid == false) {
+        UnmapFile(&mapped);
+        return false;
+    }
+
+    char texture[meshFileMaxPathLength];
+    memcpy(texture, header->texture, sizeof(texture));
+    texture[sizeof(texture) - 1] = '\0';
+
+    const AtlasRegion* region = NULL;
+    if(atlas && texture[0]) {
+        region = FindAtlasRegion(atlas, texture);
+    }
+
+    // UploadMesh only reads the arrays, so they can point into the mapping
+    memset(mesh, 0, sizeof(*mesh));
+    mesh->vertexCount = header->vertexCount;
+    mesh->triangleCount = header->indexCount / 3;
+    mesh->vertices = (float*) (mapped.data + header->positionsOffset);
+    mesh->texcoords = (float*) (mapped.data + header->texcoordsOffset);
+    mesh->normals = (float*) (mapped.data + header->normalsOffset);
+    mesh->indices = (unsigned short*) (mapped.data + header->indicesOffset);
+
+    // Mapping is read only, moved texcoords need their own copy
+    float* atlasTexcoords = NULL;
+    if(region) {
+        const Vector2* texcoords = (const Vector2*) mesh->texcoords;
+        atlasTexcoords = (float*) malloc(mesh->vertexCount * sizeof(Vector2));
+
+        for(int i = 0; i < mesh->vertexCount; i++) {
+            Vector2 texcoord = GetAtlasTexcoord(atlas, region, texcoords[i]);
+            atlasTexcoords[i * 2 + 0] = texcoord.x;
+            atlasTexcoords[i * 2 + 1] = texcoord.y;
+        }
+
+        mesh->texcoords = atlasTexcoords;
+    }
+
+    UploadMesh(mesh, false);
+
+    free(atlasTexcoords);
+
+    // Data is on the GPU now, UnloadMesh must not free the mapping
+    mesh->vertices = NULL;
+    mesh->texcoords = NULL;
+    mesh->normals = NULL;
+    mesh->indices = NULL;
+
+    *material = LoadMaterialDefault();
+
+    Color diffuse;
+    diffuse.r = (unsigned char) (header->diffuse[0] * 255.0f);
+    diffuse.g = (unsigned char) (header->diffuse[1] * 255.0f);
+    diffuse.b = (unsigned char) (header->diffuse[2] * 255.0f);
+    diffuse.a = (unsigned char) (header->diffuse[3] * 255.0f);
+    material->maps[MATERIAL_MAP_DIFFUSE].color = diffuse;
+
+    if(region) {
+        material->maps[MATERIAL_MAP_DIFFUSE].texture = atlas->texture;
+    }
+    else if(texture[0]) {
+        material->maps[MATERIAL_MAP_DIFFUSE].texture = LoadTexture(TextFormat("%s/%s", GetDirectoryPath(path), texture));
+    }
+
+    UnmapFile(&mapped);
+
+    return true;
+}
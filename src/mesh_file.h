@@ -0,0 +1,44 @@
+// Baked mesh format, written by mesh_optimizer and loaded by the game
+// without any parsing. The file is a header followed by vertex and index
+// arrays, each starting at a 16 byte aligned offset, so they can be used
+// right from the memory mapped file:
+//
+//   positions  vertexCount x f32 x3
+//   texcoords  vertexCount x f32 x2, flipped vertically like raylib does
+//   normals    vertexCount x f32 x3
+//   indices    indexCount  x u16
+//
+// Values are in native byte order, all our targets are little endian.
+
+#pragma once
+
+#include <stdint.h>
+
+const char meshFileMagic[4] = { 'S', 'T', 'F', 'M' };
+const uint32_t meshFileVersion = 1;
+
+const int meshFileAlignment = 16;
+const int meshFileMaxPathLength = 64;
+
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+
+    uint32_t vertexCount;
+    uint32_t indexCount;
+
+    // Offsets of the arrays from the start of the file
+    uint32_t positionsOffset;
+    uint32_t texcoordsOffset;
+    uint32_t normalsOffset;
+    uint32_t indicesOffset;
+
+    // Material, diffuse color and texture path
+    // relative to the mesh file, can be empty
+    float diffuse[4];
+    char texture[meshFileMaxPathLength];
+};
+
+inline uint32_t AlignMeshFileOffset(uint32_t offset) {
+    return (offset + meshFileAlignment - 1) & ~(uint32_t) (meshFileAlignment - 1);
+}
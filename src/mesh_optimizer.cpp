@@ -0,0 +1,926 @@
+// Offline optimizer for meshes exported from MagicaVoxel. The export is
+// a triangle soup of voxel faces, so the model is rebuilt from scratch:
+//
+// 1. Every triangle is rasterized into the voxel cells it covers,
+//    on its plane (axis, facing and depth) with its palette color
+// 2. Cells of every plane are greedily merged into largest rectangles
+//    of the same color, each rectangle becomes one quad
+// 3. Equal vertices are welded and an index buffer is built
+// 4. Triangles are reordered for the post-transform vertex cache
+//    (Tom Forsyth's linear-speed vertex cache optimisation)
+//
+// Result is written as OBJ, with the material of the input, or baked
+// into the binary format the game loads (mesh_file.h), when the output
+// has the .mesh extension.
+//
+// Usage: mesh_optimizer input.obj output.obj|output.mesh [--voxel-size X]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/raylib.h"
+
+#include "mesh_file.h"
+
+const int maxLineLength = 512;
+
+const int vertexCacheSize = 32;
+
+struct ObjFace {
+    int positions[3];
+    int texcoord;
+    int normal;
+};
+
+// Input as it's in the file, faces are triangulated
+struct ObjMesh {
+    Vector3* positions;
+    int positionCount;
+    Vector2* texcoords;
+    int texcoordCount;
+    Vector3* normals;
+    int normalCount;
+
+    ObjFace* faces;
+    int faceCount;
+
+    char mtllib[maxLineLength];
+    char usemtl[maxLineLength];
+};
+
+// Voxel cell on one plane, coordinates are in voxels
+struct PlaneCell {
+    int plane;
+    int u;
+    int v;
+    int texcoord;
+};
+
+// Axis aligned plane, facing the positive or negative direction of the axis
+struct Plane {
+    int axis;
+    int facing;
+    int depth;
+};
+
+struct MeshVertex {
+    int position[3];
+    int texcoord;
+    int normal;
+};
+
+struct IndexedMesh {
+    MeshVertex* vertices;
+    int vertexCount;
+
+    int* indices;
+    int triangleCount;
+};
+
+// ================
+// Growable arrays
+// ================
+template <typename T>
+T* Push(T** items, int* count, int* capacity) {
+    if(*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        *items = (T*) realloc(*items, *capacity * sizeof(T));
+    }
+
+    return &(*items)[(*count)++];
+}
+
+// ================
+// OBJ
+// ================
+// Index of v/vt/vn, which can be negative, relative to the end
+int ParseObjIndex(const char* text, int count) {
+    int index = atoi(text);
+    return index < 0 ? count + index : index - 1;
+}
+
+bool LoadObj(const char* path, ObjMesh* mesh) {
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        printf("Failed to open %s\n", path);
+        return false;
+    }
+
+    memset(mesh, 0, sizeof(*mesh));
+    int positionCapacity = 0;
+    int texcoordCapacity = 0;
+    int normalCapacity = 0;
+    int faceCapacity = 0;
+
+    char line[maxLineLength];
+    while(fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if(strncmp(line, "v ", 2) == 0) {
+            Vector3* p = Push(&mesh->positions, &mesh->positionCount, &positionCapacity);
+            sscanf(line + 2, "%f %f %f", &p->x, &p->y, &p->z);
+        }
+        else if(strncmp(line, "vt ", 3) == 0) {
+            Vector2* t = Push(&mesh->texcoords, &mesh->texcoordCount, &texcoordCapacity);
+            sscanf(line + 3, "%f %f", &t->x, &t->y);
+        }
+        else if(strncmp(line, "vn ", 3) == 0) {
+            Vector3* n = Push(&mesh->normals, &mesh->normalCount, &normalCapacity);
+            sscanf(line + 3, "%f %f %f", &n->x, &n->y, &n->z);
+        }
+        else if(strncmp(line, "f ", 2) == 0) {
+            // Polygons are triangulated as a fan
+            int corners[3];
+            int corner = 0;
+            ObjFace face = {};
+
+            for(char* token = strtok(line + 2, " \t"); token; token = strtok(NULL, " \t")) {
+                corners[corner < 2 ? corner : 2] = ParseObjIndex(token, mesh->positionCount);
+
+                char* slash = strchr(token, '/');
+                if(slash && slash[1] != '/') {
+                    face.texcoord = ParseObjIndex(slash + 1, mesh->texcoordCount);
+                }
+
+                char* secondSlash = slash ? strchr(slash + 1, '/') : NULL;
+                face.normal = secondSlash ? ParseObjIndex(secondSlash + 1, mesh->normalCount) : -1;
+
+                corner++;
+                if(corner >= 3) {
+                    face.positions[0] = corners[0];
+                    face.positions[1] = corners[1];
+                    face.positions[2] = corners[2];
+                    *Push(&mesh->faces, &mesh->faceCount, &faceCapacity) = face;
+
+                    corners[1] = corners[2];
+                }
+            }
+        }
+        else if(strncmp(line, "mtllib ", 7) == 0) {
+            strcpy(mesh->mtllib, line + 7);
+        }
+        else if(strncmp(line, "usemtl ", 7) == 0) {
+            strcpy(mesh->usemtl, line + 7);
+        }
+    }
+
+    fclose(file);
+
+    // Faces without texture coordinates point at the first one
+    if(mesh->texcoordCount == 0) {
+        *Push(&mesh->texcoords, &mesh->texcoordCount, &texcoordCapacity) = Vector2{ 0, 0 };
+    }
+
+    return true;
+}
+
+// Unique axis normals, in the order MagicaVoxel writes them
+const Vector3 axisNormals[6] = {
+    { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, 1, 0 },
+};
+
+int GetAxisNormalIndex(int axis, int facing) {
+    const int indices[3][2] = { { 0, 1 }, { 4, 5 }, { 3, 2 } };
+    return indices[axis][facing > 0 ? 1 : 0];
+}
+
+bool WriteObj(const char* path, const ObjMesh* source, const IndexedMesh* mesh, float voxelSize) {
+    FILE* file = fopen(path, "w");
+    if(file == NULL) {
+        printf("Failed to open %s for writing\n", path);
+        return false;
+    }
+
+    fprintf(file, "# Optimized by mesh_optimizer\n\n");
+
+    if(source->mtllib[0]) {
+        fprintf(file, "mtllib %s\n", source->mtllib);
+    }
+    if(source->usemtl[0]) {
+        fprintf(file, "usemtl %s\n", source->usemtl);
+    }
+
+    fprintf(file, "\n");
+    for(int i = 0; i < 6; i++) {
+        fprintf(file, "vn %g %g %g\n", axisNormals[i].x, axisNormals[i].y, axisNormals[i].z);
+    }
+
+    fprintf(file, "\n");
+    for(int i = 0; i < source->texcoordCount; i++) {
+        fprintf(file, "vt %g %g\n", source->texcoords[i].x, source->texcoords[i].y);
+    }
+
+    fprintf(file, "\n");
+    for(int i = 0; i < mesh->vertexCount; i++) {
+        const int* p = mesh->vertices[i].position;
+        fprintf(file, "v %g %g %g\n", p[0] * voxelSize, p[1] * voxelSize, p[2] * voxelSize);
+    }
+
+    fprintf(file, "\n");
+    for(int i = 0; i < mesh->triangleCount; i++) {
+        fprintf(file, "f");
+        for(int c = 0; c < 3; c++) {
+            int index = mesh->indices[i * 3 + c];
+            const MeshVertex* vertex = &mesh->vertices[index];
+            fprintf(file, " %d/%d/%d", index + 1, vertex->texcoord + 1, vertex->normal + 1);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+// Diffuse color and texture of the material the OBJ uses, from its .mtl
+void LoadObjMaterial(const char* objPath, const ObjMesh* obj, float* diffuse, char* texture, int textureSize) {
+    diffuse[0] = diffuse[1] = diffuse[2] = diffuse[3] = 1.0f;
+    texture[0] = '\0';
+
+    if(obj->mtllib[0] == '\0') {
+        return;
+    }
+
+    // Material library is relative to the OBJ
+    char path[maxLineLength * 2];
+    const char* slash = strrchr(objPath, '/');
+    int directoryLength = slash ? (int) (slash - objPath + 1) : 0;
+    snprintf(path, sizeof(path), "%.*s%s", directoryLength, objPath, obj->mtllib);
+
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        printf("Failed to open material library %s\n", path);
+        return;
+    }
+
+    bool isUsedMaterial = obj->usemtl[0] == '\0';
+
+    char line[maxLineLength];
+    while(fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if(strncmp(line, "newmtl ", 7) == 0) {
+            isUsedMaterial = obj->usemtl[0] == '\0' || strcmp(line + 7, obj->usemtl) == 0;
+        }
+        else if(isUsedMaterial && strncmp(line, "Kd ", 3) == 0) {
+            sscanf(line + 3, "%f %f %f", &diffuse[0], &diffuse[1], &diffuse[2]);
+        }
+        else if(isUsedMaterial && strncmp(line, "map_Kd ", 7) == 0) {
+            snprintf(texture, textureSize, "%s", line + 7);
+        }
+    }
+
+    fclose(file);
+}
+
+bool WriteMeshFile(const char* path, const ObjMesh* source, const IndexedMesh* mesh,
+                   float voxelSize, const float* diffuse, const char* texture) {
+    if(mesh->vertexCount > 65535) {
+        printf("Mesh has %d vertices, more than 16 bit indices can address\n", mesh->vertexCount);
+        return false;
+    }
+
+    if(strlen(texture) >= (size_t) meshFileMaxPathLength) {
+        printf("Texture path %s is too long\n", texture);
+        return false;
+    }
+
+    MeshFileHeader header = {};
+    memcpy(header.magic, meshFileMagic, sizeof(meshFileMagic));
+    header.version = meshFileVersion;
+    header.vertexCount = mesh->vertexCount;
+    header.indexCount = mesh->triangleCount * 3;
+    memcpy(header.diffuse, diffuse, sizeof(header.diffuse));
+    strcpy(header.texture, texture);
+
+    header.positionsOffset = AlignMeshFileOffset(sizeof(MeshFileHeader));
+    header.texcoordsOffset = AlignMeshFileOffset(header.positionsOffset + header.vertexCount * 3 * sizeof(float));
+    header.normalsOffset = AlignMeshFileOffset(header.texcoordsOffset + header.vertexCount * 2 * sizeof(float));
+    header.indicesOffset = AlignMeshFileOffset(header.normalsOffset + header.vertexCount * 3 * sizeof(float));
+    uint32_t size = AlignMeshFileOffset(header.indicesOffset + header.indexCount * sizeof(uint16_t));
+
+    unsigned char* data = (unsigned char*) calloc(size, 1);
+    memcpy(data, &header, sizeof(header));
+
+    float* positions = (float*) (data + header.positionsOffset);
+    float* texcoords = (float*) (data + header.texcoordsOffset);
+    float* normals = (float*) (data + header.normalsOffset);
+    uint16_t* indices = (uint16_t*) (data + header.indicesOffset);
+
+    for(int i = 0; i < mesh->vertexCount; i++) {
+        const MeshVertex* vertex = &mesh->vertices[i];
+        Vector2 texcoord = source->texcoords[vertex->texcoord];
+        Vector3 normal = axisNormals[vertex->normal];
+
+        positions[i * 3 + 0] = vertex->position[0] * voxelSize;
+        positions[i * 3 + 1] = vertex->position[1] * voxelSize;
+        positions[i * 3 + 2] = vertex->position[2] * voxelSize;
+
+        // Same flip raylib's OBJ loader does
+        texcoords[i * 2 + 0] = texcoord.x;
+        texcoords[i * 2 + 1] = 1.0f - texcoord.y;
+
+        normals[i * 3 + 0] = normal.x;
+        normals[i * 3 + 1] = normal.y;
+        normals[i * 3 + 2] = normal.z;
+    }
+
+    for(int i = 0; i < mesh->triangleCount * 3; i++) {
+        indices[i] = (uint16_t) mesh->indices[i];
+    }
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL) {
+        printf("Failed to open %s for writing\n", path);
+        free(data);
+        return false;
+    }
+
+    bool written = fwrite(data, 1, size, file) == size;
+    fclose(file);
+    free(data);
+
+    if(written == false) {
+        printf("Failed to write %s\n", path);
+    }
+
+    return written;
+}
+
+// ================
+// Voxel Planes
+// ================
+// Signed area test, cell centers on an edge count as inside,
+// so cells on the diagonal of a quad aren't lost
+bool IsInsideTriangle(float px, float py, const float* x, const float* y) {
+    float d0 = (x[1] - x[0]) * (py - y[0]) - (y[1] - y[0]) * (px - x[0]);
+    float d1 = (x[2] - x[1]) * (py - y[1]) - (y[2] - y[1]) * (px - x[1]);
+    float d2 = (x[0] - x[2]) * (py - y[2]) - (y[0] - y[2]) * (px - x[2]);
+
+    bool hasNegative = d0 < 0 || d1 < 0 || d2 < 0;
+    bool hasPositive = d0 > 0 || d1 > 0 || d2 > 0;
+
+    return (hasNegative && hasPositive) == false;
+}
+
+int FindPlane(Plane** planes, int* planeCount, int* planeCapacity, Plane plane) {
+    for(int i = 0; i < *planeCount; i++) {
+        Plane* p = &(*planes)[i];
+        if(p->axis == plane.axis && p->facing == plane.facing && p->depth == plane.depth) {
+            return i;
+        }
+    }
+
+    *Push(planes, planeCount, planeCapacity) = plane;
+    return *planeCount - 1;
+}
+
+// Adds quad of the rectangle from (u0, v0) to (u1, v1), wound counter
+// clockwise when looking against the facing direction
+void AddQuad(IndexedMesh* mesh, int* vertexCapacity, Plane plane, int u0, int v0, int u1, int v1, int texcoord) {
+    int uAxis = (plane.axis + 1) % 3;
+    int vAxis = (plane.axis + 2) % 3;
+
+    int corners[4][2] = { { u0, v0 }, { u1, v0 }, { u1, v1 }, { u0, v1 } };
+
+    // (u, v, axis) is a right handed basis, so the corners above are
+    // counter clockwise when looking from the positive side
+    int order[4] = { 0, 1, 2, 3 };
+    if(plane.facing < 0) {
+        order[1] = 3;
+        order[3] = 1;
+    }
+
+    for(int i = 0; i < 4; i++) {
+        MeshVertex* vertex = Push(&mesh->vertices, &mesh->vertexCount, vertexCapacity);
+        vertex->position[plane.axis] = plane.depth;
+        vertex->position[uAxis] = corners[order[i]][0];
+        vertex->position[vAxis] = corners[order[i]][1];
+        vertex->texcoord = texcoord;
+        vertex->normal = GetAxisNormalIndex(plane.axis, plane.facing);
+    }
+}
+
+// Builds quads of merged faces, as 4 vertices each, not welded yet
+void MergeVoxelFaces(const ObjMesh* obj, float voxelSize, IndexedMesh* mesh) {
+    Plane* planes = NULL;
+    int planeCount = 0;
+    int planeCapacity = 0;
+
+    PlaneCell* cells = NULL;
+    int cellCount = 0;
+    int cellCapacity = 0;
+
+    for(int f = 0; f < obj->faceCount; f++) {
+        const ObjFace* face = &obj->faces[f];
+
+        Vector3 p[3];
+        for(int c = 0; c < 3; c++) {
+            p[c] = obj->positions[face->positions[c]];
+        }
+
+        // Facing comes from the winding, not from vn, which may be missing
+        Vector3 e0 = { p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z };
+        Vector3 e1 = { p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z };
+        float n[3] = { e0.y * e1.z - e0.z * e1.y, e0.z * e1.x - e0.x * e1.z, e0.x * e1.y - e0.y * e1.x };
+
+        int axis = 0;
+        for(int a = 1; a < 3; a++) {
+            if(fabsf(n[a]) > fabsf(n[axis])) {
+                axis = a;
+            }
+        }
+
+        if(n[axis] == 0) {
+            continue;
+        }
+
+        float coords[3][3];
+        for(int c = 0; c < 3; c++) {
+            coords[c][0] = p[c].x / voxelSize;
+            coords[c][1] = p[c].y / voxelSize;
+            coords[c][2] = p[c].z / voxelSize;
+        }
+
+        Plane plane = {};
+        plane.axis = axis;
+        plane.facing = n[axis] > 0 ? 1 : -1;
+        plane.depth = (int) floorf(coords[0][axis] + 0.5f);
+        int planeIndex = FindPlane(&planes, &planeCount, &planeCapacity, plane);
+
+        int uAxis = (axis + 1) % 3;
+        int vAxis = (axis + 2) % 3;
+        float us[3] = { coords[0][uAxis], coords[1][uAxis], coords[2][uAxis] };
+        float vs[3] = { coords[0][vAxis], coords[1][vAxis], coords[2][vAxis] };
+
+        int minU = (int) floorf(fminf(us[0], fminf(us[1], us[2])) + 0.5f);
+        int maxU = (int) floorf(fmaxf(us[0], fmaxf(us[1], us[2])) + 0.5f);
+        int minV = (int) floorf(fminf(vs[0], fminf(vs[1], vs[2])) + 0.5f);
+        int maxV = (int) floorf(fmaxf(vs[0], fmaxf(vs[1], vs[2])) + 0.5f);
+
+        for(int v = minV; v < maxV; v++) {
+            for(int u = minU; u < maxU; u++) {
+                if(IsInsideTriangle(u + 0.5f, v + 0.5f, us, vs)) {
+                    PlaneCell* cell = Push(&cells, &cellCount, &cellCapacity);
+                    cell->plane = planeIndex;
+                    cell->u = u;
+                    cell->v = v;
+                    cell->texcoord = face->texcoord;
+                }
+            }
+        }
+    }
+
+    int vertexCapacity = 0;
+
+    for(int planeIndex = 0; planeIndex < planeCount; planeIndex++) {
+        int minU = 0, maxU = 0, minV = 0, maxV = 0;
+        bool first = true;
+
+        for(int i = 0; i < cellCount; i++) {
+            PlaneCell* cell = &cells[i];
+            if(cell->plane != planeIndex) {
+                continue;
+            }
+
+            if(first || cell->u < minU) minU = cell->u;
+            if(first || cell->u > maxU) maxU = cell->u;
+            if(first || cell->v < minV) minV = cell->v;
+            if(first || cell->v > maxV) maxV = cell->v;
+            first = false;
+        }
+
+        if(first) {
+            continue;
+        }
+
+        // Texcoord of every cell of the plane, -1 for empty
+        int width = maxU - minU + 1;
+        int height = maxV - minV + 1;
+        int* grid = (int*) malloc(width * height * sizeof(int));
+        for(int i = 0; i < width * height; i++) {
+            grid[i] = -1;
+        }
+
+        for(int i = 0; i < cellCount; i++) {
+            PlaneCell* cell = &cells[i];
+            if(cell->plane == planeIndex) {
+                grid[(cell->v - minV) * width + cell->u - minU] = cell->texcoord;
+            }
+        }
+
+        // Greedy merge. Grow along u first, then along v while the whole
+        // row has the same color, and clear the cells that were taken
+        for(int v = 0; v < height; v++) {
+            for(int u = 0; u < width; u++) {
+                int texcoord = grid[v * width + u];
+                if(texcoord < 0) {
+                    continue;
+                }
+
+                int w = 1;
+                while(u + w < width && grid[v * width + u + w] == texcoord) {
+                    w++;
+                }
+
+                int h = 1;
+                for(; v + h < height; h++) {
+                    bool rowMatches = true;
+                    for(int x = u; x < u + w; x++) {
+                        if(grid[(v + h) * width + x] != texcoord) {
+                            rowMatches = false;
+                            break;
+                        }
+                    }
+
+                    if(rowMatches == false) {
+                        break;
+                    }
+                }
+
+                for(int y = v; y < v + h; y++) {
+                    for(int x = u; x < u + w; x++) {
+                        grid[y * width + x] = -1;
+                    }
+                }
+
+                AddQuad(mesh, &vertexCapacity, planes[planeIndex],
+                        minU + u, minV + v, minU + u + w, minV + v + h, texcoord);
+            }
+        }
+
+        free(grid);
+    }
+
+    // Two triangles per quad
+    mesh->triangleCount = mesh->vertexCount / 2;
+    mesh->indices = (int*) malloc(mesh->triangleCount * 3 * sizeof(int));
+    for(int q = 0; q < mesh->vertexCount / 4; q++) {
+        int* index = &mesh->indices[q * 6];
+        index[0] = q * 4 + 0;
+        index[1] = q * 4 + 1;
+        index[2] = q * 4 + 2;
+        index[3] = q * 4 + 0;
+        index[4] = q * 4 + 2;
+        index[5] = q * 4 + 3;
+    }
+
+    free(planes);
+    free(cells);
+}
+
+// ================
+// Welding
+// ================
+unsigned int HashVertex(const MeshVertex* vertex) {
+    unsigned int hash = 2166136261u;
+    const int values[5] = { vertex->position[0], vertex->position[1], vertex->position[2],
+                            vertex->texcoord, vertex->normal };
+
+    for(int i = 0; i < 5; i++) {
+        hash = (hash ^ (unsigned int) values[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+bool VerticesEqual(const MeshVertex* a, const MeshVertex* b) {
+    return a->position[0] == b->position[0] && a->position[1] == b->position[1] &&
+           a->position[2] == b->position[2] && a->texcoord == b->texcoord && a->normal == b->normal;
+}
+
+// Merges equal vertices and remaps the indices
+void WeldVertices(IndexedMesh* mesh) {
+    int tableSize = 1;
+    while(tableSize < mesh->vertexCount * 2) {
+        tableSize *= 2;
+    }
+
+    int* table = (int*) malloc(tableSize * sizeof(int));
+    for(int i = 0; i < tableSize; i++) {
+        table[i] = -1;
+    }
+
+    int* remap = (int*) malloc(mesh->vertexCount * sizeof(int));
+    int uniqueCount = 0;
+
+    for(int i = 0; i < mesh->vertexCount; i++) {
+        MeshVertex* vertex = &mesh->vertices[i];
+        unsigned int slot = HashVertex(vertex) & (tableSize - 1);
+
+        while(table[slot] >= 0 && VerticesEqual(&mesh->vertices[table[slot]], vertex) == false) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if(table[slot] < 0) {
+            // Unique vertices are compacted in place, they never overtake i
+            mesh->vertices[uniqueCount] = *vertex;
+            table[slot] = uniqueCount++;
+        }
+
+        remap[i] = table[slot];
+    }
+
+    for(int i = 0; i < mesh->triangleCount * 3; i++) {
+        mesh->indices[i] = remap[mesh->indices[i]];
+    }
+
+    mesh->vertexCount = uniqueCount;
+
+    free(table);
+    free(remap);
+}
+
+// ================
+// Vertex Cache
+// ================
+// Scoring constants from the original article
+const float cacheDecayPower = 1.5f;
+const float lastTriangleScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+struct CacheVertex {
+    int cachePosition;
+    int remainingTriangles;
+    int triangleStart;
+    int triangleCount;
+    float score;
+};
+
+float GetVertexScore(const CacheVertex* vertex) {
+    if(vertex->remainingTriangles == 0) {
+        return -1;
+    }
+
+    float score = 0;
+    int position = vertex->cachePosition;
+
+    if(position >= 0) {
+        if(position < 3) {
+            // Triangle just drawn, using it again isn't as good as it seems,
+            // its vertices would be fetched anyway
+            score = lastTriangleScore;
+        }
+        else {
+            float scaler = 1.0f / (vertexCacheSize - 3);
+            score = powf(1.0f - (position - 3) * scaler, cacheDecayPower);
+        }
+    }
+
+    // Vertices with few triangles left are taken first, so they don't
+    // end up alone and need to be fetched again later
+    score += valenceBoostScale * powf((float) vertex->remainingTriangles, -valenceBoostPower);
+
+    return score;
+}
+
+// Average cache miss ratio, vertex transforms per triangle,
+// with a FIFO cache like the one most GPUs have
+float GetAcmr(const int* indices, int triangleCount, int cacheSize) {
+    int cache[64];
+    int cacheCount = 0;
+    int cacheHead = 0;
+    int misses = 0;
+
+    for(int i = 0; i < triangleCount * 3; i++) {
+        bool hit = false;
+        for(int c = 0; c < cacheCount; c++) {
+            if(cache[c] == indices[i]) {
+                hit = true;
+                break;
+            }
+        }
+
+        if(hit == false) {
+            misses++;
+            cache[cacheHead] = indices[i];
+            cacheHead = (cacheHead + 1) % cacheSize;
+            cacheCount = cacheCount < cacheSize ? cacheCount + 1 : cacheSize;
+        }
+    }
+
+    return triangleCount > 0 ? (float) misses / triangleCount : 0;
+}
+
+void OptimizeVertexCache(IndexedMesh* mesh) {
+    int triangleCount = mesh->triangleCount;
+    int* indices = mesh->indices;
+
+    CacheVertex* vertices = (CacheVertex*) calloc(mesh->vertexCount, sizeof(CacheVertex));
+    int* vertexTriangles = (int*) malloc(triangleCount * 3 * sizeof(int));
+    float* triangleScores = (float*) malloc(triangleCount * sizeof(float));
+    bool* triangleAdded = (bool*) calloc(triangleCount, sizeof(bool));
+    int* output = (int*) malloc(triangleCount * 3 * sizeof(int));
+
+    // Triangles of every vertex
+    for(int i = 0; i < triangleCount * 3; i++) {
+        vertices[indices[i]].triangleCount++;
+    }
+
+    int start = 0;
+    for(int v = 0; v < mesh->vertexCount; v++) {
+        vertices[v].triangleStart = start;
+        vertices[v].remainingTriangles = vertices[v].triangleCount;
+        vertices[v].cachePosition = -1;
+        start += vertices[v].triangleCount;
+        vertices[v].triangleCount = 0;
+    }
+
+    for(int i = 0; i < triangleCount * 3; i++) {
+        CacheVertex* vertex = &vertices[indices[i]];
+        vertexTriangles[vertex->triangleStart + vertex->triangleCount++] = i / 3;
+    }
+
+    for(int v = 0; v < mesh->vertexCount; v++) {
+        vertices[v].score = GetVertexScore(&vertices[v]);
+    }
+
+    for(int t = 0; t < triangleCount; t++) {
+        triangleScores[t] = vertices[indices[t * 3]].score + vertices[indices[t * 3 + 1]].score +
+                            vertices[indices[t * 3 + 2]].score;
+    }
+
+    // Three extra slots for vertices of the new triangle, before they push others out
+    int cache[vertexCacheSize + 3];
+    int cacheCount = 0;
+
+    int bestTriangle = -1;
+    int addedCount = 0;
+
+    while(addedCount < triangleCount) {
+        // Nothing useful in the cache, pick the best triangle of all
+        if(bestTriangle < 0) {
+            float bestScore = -1;
+            for(int t = 0; t < triangleCount; t++) {
+                if(triangleAdded[t] == false && triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        triangleAdded[bestTriangle] = true;
+        int* triangle = &indices[bestTriangle * 3];
+        memcpy(&output[addedCount * 3], triangle, 3 * sizeof(int));
+        addedCount++;
+
+        // Vertices of the triangle go to the front of the LRU cache
+        int newCache[vertexCacheSize + 3];
+        int newCount = 0;
+        for(int c = 0; c < 3; c++) {
+            newCache[newCount++] = triangle[c];
+
+            CacheVertex* vertex = &vertices[triangle[c]];
+            vertex->remainingTriangles--;
+
+            // Swap the triangle out of the vertex's list of remaining ones
+            int* list = &vertexTriangles[vertex->triangleStart];
+            for(int i = 0; i <= vertex->remainingTriangles; i++) {
+                if(list[i] == bestTriangle) {
+                    list[i] = list[vertex->remainingTriangles];
+                    list[vertex->remainingTriangles] = bestTriangle;
+                    break;
+                }
+            }
+        }
+
+        for(int c = 0; c < cacheCount; c++) {
+            int v = cache[c];
+            if(v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache[newCount++] = v;
+            }
+        }
+
+        // Update scores of everything that was in the cache, including
+        // the vertices that just fell out of it
+        for(int c = 0; c < newCount; c++) {
+            CacheVertex* vertex = &vertices[newCache[c]];
+            vertex->cachePosition = c < vertexCacheSize ? c : -1;
+            vertex->score = GetVertexScore(vertex);
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1;
+        for(int c = 0; c < newCount; c++) {
+            CacheVertex* vertex = &vertices[newCache[c]];
+
+            for(int i = 0; i < vertex->remainingTriangles; i++) {
+                int t = vertexTriangles[vertex->triangleStart + i];
+                int* tri = &indices[t * 3];
+                triangleScores[t] = vertices[tri[0]].score + vertices[tri[1]].score + vertices[tri[2]].score;
+
+                if(triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = newCount < vertexCacheSize ? newCount : vertexCacheSize;
+        memcpy(cache, newCache, cacheCount * sizeof(int));
+    }
+
+    memcpy(indices, output, triangleCount * 3 * sizeof(int));
+
+    free(vertices);
+    free(vertexTriangles);
+    free(triangleScores);
+    free(triangleAdded);
+    free(output);
+}
+
+// Renumbers vertices in the order triangles first use them,
+// so vertex fetches go through memory mostly forward
+void ReorderVertices(IndexedMesh* mesh) {
+    int* remap = (int*) malloc(mesh->vertexCount * sizeof(int));
+    for(int i = 0; i < mesh->vertexCount; i++) {
+        remap[i] = -1;
+    }
+
+    MeshVertex* ordered = (MeshVertex*) malloc(mesh->vertexCount * sizeof(MeshVertex));
+    int count = 0;
+
+    for(int i = 0; i < mesh->triangleCount * 3; i++) {
+        int index = mesh->indices[i];
+        if(remap[index] < 0) {
+            remap[index] = count;
+            ordered[count++] = mesh->vertices[index];
+        }
+
+        mesh->indices[i] = remap[index];
+    }
+
+    free(mesh->vertices);
+    mesh->vertices = ordered;
+    mesh->vertexCount = count;
+
+    free(remap);
+}
+
+int main(int argc, char** argv)
+{
+    const char* inputPath = NULL;
+    const char* outputPath = NULL;
+    float voxelSize = 0.1f;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--voxel-size") == 0 && i + 1 < argc) {
+            voxelSize = (float) atof(argv[++i]);
+        }
+        else if(inputPath == NULL) {
+            inputPath = argv[i];
+        }
+        else if(outputPath == NULL) {
+            outputPath = argv[i];
+        }
+    }
+
+    if(inputPath == NULL || outputPath == NULL || voxelSize <= 0) {
+        printf("Usage: %s input.obj output.obj|output.mesh [--voxel-size X]\n", argv[0]);
+        return 1;
+    }
+
+    ObjMesh obj;
+    if(LoadObj(inputPath, &obj) == false) {
+        return 1;
+    }
+
+    IndexedMesh mesh = {};
+    MergeVoxelFaces(&obj, voxelSize, &mesh);
+    int mergedVertexCount = mesh.vertexCount;
+
+    WeldVertices(&mesh);
+    OptimizeVertexCache(&mesh);
+    ReorderVertices(&mesh);
+
+    const char* extension = strrchr(outputPath, '.');
+    bool bake = extension && strcmp(extension, ".mesh") == 0;
+
+    if(bake) {
+        float diffuse[4];
+        char texture[meshFileMaxPathLength * 2];
+        LoadObjMaterial(inputPath, &obj, diffuse, texture, sizeof(texture));
+
+        if(WriteMeshFile(outputPath, &obj, &mesh, voxelSize, diffuse, texture) == false) {
+            return 1;
+        }
+    }
+    else if(WriteObj(outputPath, &obj, &mesh, voxelSize) == false) {
+        return 1;
+    }
+
+    // raylib loads OBJ without indices, three vertices per triangle,
+    // so every vertex is transformed, ACMR is 3
+    printf("input:  %d positions, %d triangles, %d vertices as loaded\n",
+           obj.positionCount, obj.faceCount, obj.faceCount * 3);
+    printf("merged: %d quads, %d triangles\n", mergedVertexCount / 4, mesh.triangleCount);
+    printf("output: %d vertices, %d triangles, %d indices, ACMR %.3f (best possible %.3f)\n",
+           mesh.vertexCount, mesh.triangleCount, mesh.triangleCount * 3,
+           GetAcmr(mesh.indices, mesh.triangleCount, vertexCacheSize),
+           (float) mesh.vertexCount / mesh.triangleCount);
+
+    return 0;
+}
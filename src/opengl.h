@@ -0,0 +1,113 @@
+// Minimal OpenGL declarations, for the few calls rlgl doesn't wrap.
+// OpenGL 1.1 / ES 2.0 core functions are exported by every platform
+// directly. Newer ones, like the timer queries, have to be loaded with
+// GetGlProcAddress, and can be missing. GLX returns a pointer for any
+// name, so check HasGlVersion or HasGlExtension before loading them.
+
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define GL_IMPORT __declspec(dllimport)
+#define GL_CALL __stdcall
+#else
+#define GL_IMPORT
+#define GL_CALL
+#endif
+
+// Blend factors and equations for rlSetBlendFactors
+#define GL_ZERO 0
+#define GL_ONE 1
+#define GL_ONE_MINUS_SRC_ALPHA 0x0303
+#define GL_FUNC_ADD 0x8006
+
+#define GL_VERSION 0x1F02
+#define GL_EXTENSIONS 0x1F03
+
+// Timer queries, OpenGL 3.3 or ARB_timer_query
+#define GL_TIMESTAMP 0x8E28
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+
+extern "C" {
+    // rlDrawVertexArray always draws triangles
+    GL_IMPORT void GL_CALL glDrawArrays(unsigned int mode, int first, int count);
+    GL_IMPORT const unsigned char* GL_CALL glGetString(unsigned int name);
+
+#if !WEB_BUILD
+#if defined(_WIN32)
+    GL_IMPORT void* GL_CALL wglGetProcAddress(const char* name);
+#else
+    void* glXGetProcAddressARB(const unsigned char* name);
+#endif
+#endif
+}
+
+typedef void (GL_CALL *GlGenQueries)(int count, unsigned int* ids);
+typedef void (GL_CALL *GlDeleteQueries)(int count, const unsigned int* ids);
+typedef void (GL_CALL *GlQueryCounter)(unsigned int id, unsigned int target);
+typedef void (GL_CALL *GlGetQueryObjectiv)(unsigned int id, unsigned int name, int* value);
+typedef void (GL_CALL *GlGetQueryObjectui64v)(unsigned int id, unsigned int name, unsigned long long* value);
+
+// NULL when the function isn't there, or there's no loader (web)
+inline void* GetGlProcAddress(const char* name) {
+#if WEB_BUILD
+    (void) name;
+    return NULL;
+#elif defined(_WIN32)
+    // Some drivers return small numbers instead of NULL
+    void* proc = wglGetProcAddress(name);
+    if((size_t) proc <= 3 || proc == (void*) -1) {
+        return NULL;
+    }
+    return proc;
+#else
+    return glXGetProcAddressARB((const unsigned char*) name);
+#endif
+}
+
+// Desktop OpenGL of at least this version, ES never passes
+inline bool HasGlVersion(int major, int minor) {
+    const char* version = (const char*) glGetString(GL_VERSION);
+    if(version == NULL || version[0] < '0' || version[0] > '9') {
+        return false;
+    }
+
+    // "major.minor", then anything vendor specific
+    int versionMajor = 0;
+    int versionMinor = 0;
+    const char* c = version;
+    for(; *c >= '0' && *c <= '9'; c++) {
+        versionMajor = versionMajor * 10 + (*c - '0');
+    }
+    if(*c == '.') {
+        for(c++; *c >= '0' && *c <= '9'; c++) {
+            versionMinor = versionMinor * 10 + (*c - '0');
+        }
+    }
+
+    return versionMajor > major || (versionMajor == major && versionMinor >= minor);
+}
+
+// Extension in the legacy extension string. Core profiles don't have
+// it, but everything we ask for is core in them anyway
+inline bool HasGlExtension(const char* name) {
+    const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+    if(extensions == NULL) {
+        return false;
+    }
+
+    size_t length = strlen(name);
+    for(const char* found = strstr(extensions, name); found; found = strstr(found + length, name)) {
+        // Whole names only, not prefixes of longer ones
+        bool start = found == extensions || found[-1] == ' ';
+        bool end = found[length] == ' ' || found[length] == '\0';
+        if(start && end) {
+            return true;
+        }
+    }
+
+    return false;
+}
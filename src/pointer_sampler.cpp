@@ -0,0 +1,371 @@
+// High rate pointer sampling. Every pointer position is recorded with
+// its GetTime() timestamp into a lock-free single producer / single
+// consumer queue. Once per frame the queue is drained into a PointerTrack,
+// which can tell where the pointer was at any moment of the recent past,
+// so every simulation step gets the pointer position at its own time.
+//
+// Producers:
+// - Windows: sampler thread polling the OS cursor at ~1 kHz
+// - Linux: sampler thread polling the X server at ~1 kHz
+// - Web: mousemove callback, called for every browser event
+// - Other: one sample per frame, from GetMousePosition()
+//
+// Desktop samplers poll instead of listening for mouse events, because
+// the window and its events are owned by GLFW inside raylib. The Linux
+// one has its own X connection, Xlib calls on GLFW's would race with it.
+
+#include <atomic>
+#include <stdio.h>
+
+#if WEB_BUILD
+#include <emscripten/html5.h>
+#elif defined(_WIN32)
+#include <thread>
+#include "win32.h"
+#elif defined(__linux__)
+#include <chrono>
+#include <thread>
+#include "x11.h"
+#endif
+
+#include "include/raylib.h"
+#include "include/raymath.h"
+
+struct PointerSample {
+    Vector2 position;
+    double time;
+
+    // Added by the consumer when nothing moved during a frame
+    bool isHold;
+};
+
+// Must be power of two
+const unsigned int pointerQueueSize = 1024;
+const int pointerTrackSize = 256;
+
+struct PointerQueue {
+    PointerSample samples[pointerQueueSize];
+
+    // Written only by the producer / consumer respectively
+    std::atomic<unsigned int> head;
+    std::atomic<unsigned int> tail;
+};
+
+// Recent samples ordered by time, oldest first
+struct PointerTrack {
+    PointerSample samples[pointerTrackSize];
+    int start;
+    int count;
+};
+
+struct PointerSampler {
+    PointerQueue queue;
+    PointerTrack track;
+
+    // There's a producer sampling the pointer between the frames. Without
+    // it, the track gets one sample per frame, see UpdatePointerSampler
+    bool async;
+    // GetTime() of the last time raylib polled the input events
+    double pollTime;
+    // Some samples came since the last UpdatePointerSampler,
+    // also counts the ones drained by the late latch
+    bool received;
+
+    std::atomic<bool> running;
+#if !WEB_BUILD && (defined(_WIN32) || defined(__linux__))
+    std::thread thread;
+#endif
+#if !WEB_BUILD && defined(__linux__)
+    X11Display* display;
+    // Client area position on the screen, x in the high 32 bits, y in the
+    // low ones. Set by the main thread, the window can be moved
+    std::atomic<unsigned long long> windowOrigin;
+#endif
+};
+
+bool PushPointerSample(PointerQueue* queue, PointerSample sample) {
+    unsigned int head = queue->head.load(std::memory_order_relaxed);
+    unsigned int tail = queue->tail.load(std::memory_order_acquire);
+
+    // Queue is full, consumer is too slow. Drop the sample
+    if(head - tail == pointerQueueSize) {
+        return false;
+    }
+
+    queue->samples[head & (pointerQueueSize - 1)] = sample;
+    queue->head.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool PopPointerSample(PointerQueue* queue, PointerSample* sample) {
+    unsigned int tail = queue->tail.load(std::memory_order_relaxed);
+    unsigned int head = queue->head.load(std::memory_order_acquire);
+
+    if(tail == head) {
+        return false;
+    }
+
+    *sample = queue->samples[tail & (pointerQueueSize - 1)];
+    queue->tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+PointerSample* GetTrackSample(PointerTrack* track, int index) {
+    return &track->samples[(track->start + index) % pointerTrackSize];
+}
+
+void AddTrackSample(PointerTrack* track, PointerSample sample) {
+    if(track->count > 0) {
+        PointerSample* last = GetTrackSample(track, track->count - 1);
+
+        // Producer could still have a sample in flight, when we added the hold
+        if(last->isHold && sample.time < last->time) {
+            track->count--;
+        }
+        else if(sample.time < last->time) {
+            return;
+        }
+    }
+
+    if(track->count == pointerTrackSize) {
+        track->start = (track->start + 1) % pointerTrackSize;
+        track->count--;
+    }
+
+    track->samples[(track->start + track->count) % pointerTrackSize] = sample;
+    track->count++;
+}
+
+// Position of the pointer at given time, linearly interpolated
+// between the samples. Outside of the recorded range it's clamped
+Vector2 GetTrackPosition(PointerTrack* track, double time) {
+    if(track->count == 0) {
+        return GetMousePosition();
+    }
+
+    PointerSample* first = GetTrackSample(track, 0);
+    PointerSample* last = GetTrackSample(track, track->count - 1);
+
+    if(time <= first->time) {
+        return first->position;
+    }
+
+    if(time >= last->time) {
+        return last->position;
+    }
+
+    // Steps usually ask for recent times, so search from the end
+    for(int i = track->count - 1; i > 0; i--) {
+        PointerSample* a = GetTrackSample(track, i - 1);
+        PointerSample* b = GetTrackSample(track, i);
+
+        if(a->time <= time) {
+            double span = b->time - a->time;
+            float t = span > 0 ? (float) ((time - a->time) / span) : 1;
+            return Vector2Lerp(a->position, b->position, t);
+        }
+    }
+
+    return last->position;
+}
+
+// Pointer is known up to this time, the newest sample, or now when
+// nothing was sampled yet. Steps past it would only see the last
+// position and leave the movement to the steps after
+double GetPointerTrackTime(PointerTrack* track, double now) {
+    if(track->count == 0) {
+        return now;
+    }
+
+    double time = GetTrackSample(track, track->count - 1)->time;
+    return time < now ? time : now;
+}
+
+#if WEB_BUILD
+
+EM_BOOL PointerSamplerMouseMove(int eventType, const EmscriptenMouseEvent* event, void* userData) {
+    PointerSampler* sampler = (PointerSampler*) userData;
+
+    PointerSample sample = {};
+    sample.position = { (float) event->targetX, (float) event->targetY };
+    sample.time = GetTime();
+    PushPointerSample(&sampler->queue, sample);
+
+    // Let raylib handle the event as well
+    return EM_FALSE;
+}
+
+#elif defined(_WIN32)
+
+void PointerSamplerThread(PointerSampler* sampler, void* window) {
+    Win32Point lastPoint = {};
+
+    while(sampler->running.load(std::memory_order_relaxed)) {
+        Win32Point point;
+        if(GetCursorPos(&point) && ScreenToClient(window, &point)) {
+            if(point.x != lastPoint.x || point.y != lastPoint.y) {
+                PointerSample sample = {};
+                sample.position = { (float) point.x, (float) point.y };
+                sample.time = GetTime();
+                PushPointerSample(&sampler->queue, sample);
+
+                lastPoint = point;
+            }
+        }
+
+        // raylib sets timer resolution to 1 ms, so this gives us ~1 kHz
+        Sleep(1);
+    }
+}
+
+#elif defined(__linux__)
+
+void SetPointerSamplerWindowOrigin(PointerSampler* sampler) {
+    Vector2 origin = GetWindowPosition();
+    unsigned long long packed = ((unsigned long long) (unsigned int) (int) origin.x << 32) |
+                                (unsigned int) (int) origin.y;
+    sampler->windowOrigin.store(packed, std::memory_order_relaxed);
+}
+
+void PointerSamplerThread(PointerSampler* sampler) {
+    X11Window root = XDefaultRootWindow(sampler->display);
+    int lastX = 0;
+    int lastY = 0;
+
+    while(sampler->running.load(std::memory_order_relaxed)) {
+        X11Window pointerRoot;
+        X11Window child;
+        int x, y, windowX, windowY;
+        unsigned int mask;
+        if(XQueryPointer(sampler->display, root, &pointerRoot, &child, &x, &y, &windowX, &windowY, &mask)) {
+            unsigned long long origin = sampler->windowOrigin.load(std::memory_order_relaxed);
+            x -= (int) (unsigned int) (origin >> 32);
+            y -= (int) (unsigned int) origin;
+
+            if(x != lastX || y != lastY) {
+                PointerSample sample = {};
+                sample.position = { (float) x, (float) y };
+                sample.time = GetTime();
+                PushPointerSample(&sampler->queue, sample);
+
+                lastX = x;
+                lastY = y;
+            }
+        }
+
+        // Query is a round trip to the X server, it takes well under this
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+#endif
+
+void StartPointerSampler(PointerSampler* sampler) {
+    sampler->running = true;
+    sampler->pollTime = GetTime();
+
+#if WEB_BUILD
+    emscripten_set_mousemove_callback("#canvas", sampler, EM_FALSE, PointerSamplerMouseMove);
+    sampler->async = true;
+#elif defined(_WIN32)
+    sampler->thread = std::thread(PointerSamplerThread, sampler, GetWindowHandle());
+    sampler->async = true;
+#elif defined(__linux__)
+    // No X server, e.g. Wayland without XWayland, falls back to frames
+    sampler->display = XOpenDisplay(NULL);
+    if(sampler->display) {
+        SetPointerSamplerWindowOrigin(sampler);
+        sampler->thread = std::thread(PointerSamplerThread, sampler);
+        sampler->async = true;
+    }
+    else {
+        printf("Can't connect to the X server, pointer is sampled once per frame\n");
+    }
+#endif
+}
+
+void StopPointerSampler(PointerSampler* sampler) {
+    sampler->running = false;
+
+#if WEB_BUILD
+    emscripten_set_mousemove_callback("#canvas", NULL, EM_FALSE, NULL);
+#elif defined(_WIN32) || defined(__linux__)
+    if(sampler->thread.joinable()) {
+        sampler->thread.join();
+    }
+#endif
+
+#if !WEB_BUILD && defined(__linux__)
+    if(sampler->display) {
+        XCloseDisplay(sampler->display);
+        sampler->display = NULL;
+    }
+#endif
+
+    sampler->async = false;
+}
+
+// Call right after raylib polls the input events, GetMousePosition()
+// of the per frame fallback is from then
+void MarkPointerPolled(PointerSampler* sampler) {
+    sampler->pollTime = GetTime();
+
+#if !WEB_BUILD && defined(__linux__)
+    if(sampler->display) {
+        SetPointerSamplerWindowOrigin(sampler);
+    }
+#endif
+}
+
+// Moves new samples from the queue into the track, without adding any
+// samples of its own, so the track is the same no matter how often it's
+// called. Only samples of the producers, the fallback doesn't have any
+void DrainPointerQueue(PointerSampler* sampler) {
+    PointerSample sample;
+    while(PopPointerSample(&sampler->queue, &sample)) {
+        AddTrackSample(&sampler->track, sample);
+        sampler->received = true;
+    }
+}
+
+// Newest sample a producer actually read, NULL if there's none
+PointerSample* GetLatestPointerSample(PointerSampler* sampler) {
+    PointerTrack* track = &sampler->track;
+    for(int i = track->count - 1; i >= 0; i--) {
+        PointerSample* sample = GetTrackSample(track, i);
+        if(sample->isHold == false) {
+            return sample;
+        }
+    }
+
+    return NULL;
+}
+
+// Moves new samples from the queue into the track. Called once per frame
+// on the main thread, after raylib polled the input events
+void UpdatePointerSampler(PointerSampler* sampler) {
+    PointerTrack* track = &sampler->track;
+    DrainPointerQueue(sampler);
+
+    PointerSample sample = {};
+    if(sampler->async == false) {
+        // No sampler, use the position raylib polled at the end of
+        // the previous frame, at the time it was polled
+        sample.position = GetMousePosition();
+        sample.time = sampler->pollTime;
+        AddTrackSample(track, sample);
+    }
+    else if(sampler->received == false && track->count > 0) {
+        // Producers report only movement. If the pointer didn't move during
+        // this frame, it's still where it was, otherwise the next movement
+        // would be spread over the whole time it was still
+        sample = *GetTrackSample(track, track->count - 1);
+        sample.time = GetTime();
+        sample.isHold = true;
+        AddTrackSample(track, sample);
+    }
+
+    sampler->received = false;
+}
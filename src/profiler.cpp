@@ -0,0 +1,185 @@
+// Simple per-phase frame profiler with an on-screen overlay.
+// Times are measured with GetTime() and kept in a fixed-size ring buffer,
+// so the overlay shows statistics of the last profilerSampleCount frames.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/raylib.h"
+
+enum ProfilerPhase {
+    PROFILER_PHASE_MUSIC,
+    PROFILER_PHASE_UPDATE,
+    PROFILER_PHASE_DRAW,
+    PROFILER_PHASE_END_DRAWING,
+
+    PROFILER_PHASE_COUNT,
+};
+
+// Whole frame, from one ProfilerBeginFrame to the next,
+// is stored as one more "phase" after the real ones
+const int profilerRowCount = PROFILER_PHASE_COUNT + 1;
+const int profilerFrameRow = PROFILER_PHASE_COUNT;
+
+const int profilerSampleCount = 240;
+const float profilerBudgetMs = 1000.0f / 60.0f;
+
+const char* profilerPhaseNames[profilerRowCount] = {
+    "Music",
+    "Update",
+    "Draw",
+    "EndDrawing",
+    "Frame",
+};
+
+const Color profilerPhaseColors[profilerRowCount] = {
+    SKYBLUE,
+    ORANGE,
+    LIME,
+    PURPLE,
+    DARKGRAY,
+};
+
+struct ProfilerStats {
+    float min;
+    float avg;
+    float p99;
+    float max;
+};
+
+struct FrameProfiler {
+    // Milliseconds, ring buffer per row
+    float samples[profilerRowCount][profilerSampleCount];
+    int head;
+    int count;
+
+    float current[profilerRowCount];
+
+    double frameStart;
+    double phaseStart;
+
+    bool visible;
+};
+
+int CompareFloats(const void* a, const void* b) {
+    float x = *(const float*) a;
+    float y = *(const float*) b;
+    return (x > y) - (x < y);
+}
+
+void ProfilerBeginFrame(FrameProfiler* profiler) {
+    double now = GetTime();
+
+    // Previous frame is finished only now, because EndDrawing
+    // waits for the target framerate
+    if(profiler->frameStart > 0) {
+        profiler->current[profilerFrameRow] = (float) ((now - profiler->frameStart) * 1000);
+
+        for(int i = 0; i < profilerRowCount; i++) {
+            profiler->samples[i][profiler->head] = profiler->current[i];
+        }
+
+        profiler->head = (profiler->head + 1) % profilerSampleCount;
+        if(profiler->count < profilerSampleCount) {
+            profiler->count++;
+        }
+    }
+
+    memset(profiler->current, 0, sizeof(profiler->current));
+    profiler->frameStart = now;
+}
+
+void ProfilerBeginPhase(FrameProfiler* profiler) {
+    profiler->phaseStart = GetTime();
+}
+
+void ProfilerEndPhase(FrameProfiler* profiler, ProfilerPhase phase) {
+    profiler->current[phase] += (float) ((GetTime() - profiler->phaseStart) * 1000);
+}
+
+ProfilerStats ProfilerGetStats(FrameProfiler* profiler, int row) {
+    ProfilerStats stats = {};
+    if(profiler->count == 0) {
+        return stats;
+    }
+
+    float sorted[profilerSampleCount];
+    memcpy(sorted, profiler->samples[row], profiler->count * sizeof(float));
+    qsort(sorted, profiler->count, sizeof(float), CompareFloats);
+
+    float sum = 0;
+    for(int i = 0; i < profiler->count; i++) {
+        sum += sorted[i];
+    }
+
+    stats.min = sorted[0];
+    stats.avg = sum / profiler->count;
+    stats.p99 = sorted[(profiler->count - 1) * 99 / 100];
+    stats.max = sorted[profiler->count - 1];
+
+    return stats;
+}
+
+void DrawProfiler(FrameProfiler* profiler, int x, int y) {
+    const int textSize = 20;
+    const int lineHeight = 24;
+    const int panelWidth = 620;
+    const int graphHeight = 120;
+    const float graphMaxMs = profilerBudgetMs * 2;
+
+    int panelHeight = (profilerRowCount + 1) * lineHeight + graphHeight + 20;
+    DrawRectangle(x, y, panelWidth, panelHeight, {0, 0, 0, 180});
+
+    // Default font isn't monospaced, so every column has its own position
+    const int nameWidth = 140;
+    const int columnWidth = 110;
+    const char* columns[] = { "min", "avg", "p99", "max [ms]" };
+
+    int textX = x + 10;
+    int textY = y + 6;
+    DrawText("phase", textX, textY, textSize, WHITE);
+    for(int i = 0; i < 4; i++) {
+        DrawText(columns[i], textX + nameWidth + i * columnWidth, textY, textSize, WHITE);
+    }
+    textY += lineHeight;
+
+    for(int i = 0; i < profilerRowCount; i++) {
+        ProfilerStats stats = ProfilerGetStats(profiler, i);
+
+        Color color = i == profilerFrameRow ? WHITE : profilerPhaseColors[i];
+
+        float values[] = { stats.min, stats.avg, stats.p99, stats.max };
+
+        DrawText(profilerPhaseNames[i], textX, textY, textSize, color);
+        for(int v = 0; v < 4; v++) {
+            DrawText(TextFormat("%.2f", values[v]), textX + nameWidth + v * columnWidth, textY, textSize, color);
+        }
+        textY += lineHeight;
+    }
+
+    // Frame time graph, each column stacks the phases of one frame,
+    // the oldest frame is on the left
+    int graphX = x + 10;
+    int graphY = textY + 6;
+    int graphWidth = panelWidth - 20;
+    float barWidth = (float) graphWidth / profilerSampleCount;
+    float pixelsPerMs = graphHeight / graphMaxMs;
+
+    DrawRectangle(graphX, graphY, graphWidth, graphHeight, {255, 255, 255, 30});
+
+    for(int i = 0; i < profiler->count; i++) {
+        int sample = (profiler->head - profiler->count + i + profilerSampleCount) % profilerSampleCount;
+        float barX = graphX + (profilerSampleCount - profiler->count + i) * barWidth;
+        float bottom = (float) (graphY + graphHeight);
+
+        for(int phase = 0; phase < PROFILER_PHASE_COUNT; phase++) {
+            float height = fminf(profiler->samples[phase][sample] * pixelsPerMs, bottom - graphY);
+            DrawRectangleRec({barX, bottom - height, barWidth, height}, profilerPhaseColors[phase]);
+            bottom -= height;
+        }
+    }
+
+    int budgetY = graphY + graphHeight - (int) (profilerBudgetMs * pixelsPerMs);
+    DrawLine(graphX, budgetY, graphX + graphWidth, budgetY, RED);
+}
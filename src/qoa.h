@@ -0,0 +1,199 @@
+// QOA, the "Quite OK Audio" format (https://qoaformat.org), written by
+// audio_transcoder and decoded by the game. Lossy, 3.2 bits per sample,
+// and decoding is a handful of integer operations per sample.
+//
+//   file header   "qoaf", samples per channel            u32 u32
+//   frames        up to qoaFrameLength samples per channel each
+//
+//   frame header  channels, sample rate, samples, size   u8 u24 u16 u16
+//   LMS state     history and weights per channel        4 x s16, 4 x s16
+//   slices        qoaSliceLength samples of a channel each, channels
+//                 interleaved, a 4 bit scale factor and 3 bit residuals
+//
+// Everything is big endian. Frames start with the full decoder state,
+// so each one can be decoded on its own, and every frame but the last
+// has the same size, which makes seeking simple.
+
+#pragma once
+
+#include <stdint.h>
+
+const uint32_t qoaMagic = 0x716f6166; // "qoaf"
+
+const int qoaFileHeaderSize = 8;
+const int qoaFrameHeaderSize = 8;
+const int qoaMaxChannels = 8;
+
+const int qoaSliceLength = 20;
+const int qoaSlicesPerFrame = 256;
+const int qoaFrameLength = qoaSliceLength * qoaSlicesPerFrame;
+
+const int qoaLmsLength = 4;
+
+struct QoaLms {
+    int history[qoaLmsLength];
+    int weights[qoaLmsLength];
+};
+
+struct QoaFrameHeader {
+    int channels;
+    int sampleRate;
+    int samples;
+    int size;
+};
+
+// Round(pow(s + 1, 2.75))
+const int qoaScaleFactors[16] = {
+    1, 7, 21, 45, 84, 138, 211, 304, 421, 562, 731, 928, 1157, 1419, 1715, 2048,
+};
+
+// 65536 / scale factor rounded up, so residuals are divided with a multiply
+const int qoaReciprocals[16] = {
+    65536, 9363, 3121, 1457, 781, 475, 311, 216, 156, 117, 90, 71, 57, 47, 39, 32,
+};
+
+// Residual divided by the scale factor, clamped to -8..8, to its 3 bits
+const int qoaQuantize[17] = {
+    7, 7, 7, 5, 5, 3, 3, 1, 0, 0, 2, 2, 4, 4, 6, 6, 6,
+};
+
+// Round(scale factor * { 0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7 })
+const int qoaDequantize[16][8] = {
+    {    1,    -1,    3,    -3,    5,    -5,     7,     -7 },
+    {    5,    -5,   18,   -18,   32,   -32,    49,    -49 },
+    {   16,   -16,   53,   -53,   95,   -95,   147,   -147 },
+    {   34,   -34,  113,  -113,  203,  -203,   315,   -315 },
+    {   63,   -63,  210,  -210,  378,  -378,   588,   -588 },
+    {  104,  -104,  345,  -345,  621,  -621,   966,   -966 },
+    {  158,  -158,  528,  -528,  950,  -950,  1477,  -1477 },
+    {  228,  -228,  760,  -760, 1368, -1368,  2128,  -2128 },
+    {  316,  -316, 1053, -1053, 1895, -1895,  2947,  -2947 },
+    {  422,  -422, 1405, -1405, 2529, -2529,  3934,  -3934 },
+    {  548,  -548, 1828, -1828, 3290, -3290,  5117,  -5117 },
+    {  696,  -696, 2320, -2320, 4176, -4176,  6496,  -6496 },
+    {  868,  -868, 2893, -2893, 5207, -5207,  8099,  -8099 },
+    { 1064, -1064, 3548, -3548, 6386, -6386,  9933,  -9933 },
+    { 1286, -1286, 4288, -4288, 7718, -7718, 12005, -12005 },
+    { 1536, -1536, 5120, -5120, 9216, -9216, 14336, -14336 },
+};
+
+inline int ClampQoaSample(int value) {
+    return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+inline int PredictQoaSample(const QoaLms* lms) {
+    int prediction = 0;
+    for(int i = 0; i < qoaLmsLength; i++) {
+        prediction += lms->weights[i] * lms->history[i];
+    }
+    return prediction >> 13;
+}
+
+inline void UpdateQoaLms(QoaLms* lms, int sample, int residual) {
+    int delta = residual >> 4;
+    for(int i = 0; i < qoaLmsLength; i++) {
+        lms->weights[i] += lms->history[i] < 0 ? -delta : delta;
+    }
+
+    for(int i = 0; i < qoaLmsLength - 1; i++) {
+        lms->history[i] = lms->history[i + 1];
+    }
+    lms->history[qoaLmsLength - 1] = sample;
+}
+
+inline uint64_t ReadQoaU64(const unsigned char* bytes) {
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+inline void WriteQoaU64(unsigned char* bytes, uint64_t value) {
+    for(int i = 7; i >= 0; i--) {
+        bytes[i] = (unsigned char) value;
+        value >>= 8;
+    }
+}
+
+// Size of a frame with the given samples per channel
+inline int GetQoaFrameSize(int channels, int samples) {
+    int slices = (samples + qoaSliceLength - 1) / qoaSliceLength;
+    return qoaFrameHeaderSize + channels * (16 + slices * 8);
+}
+
+// Returns samples per channel, or -1 when it isn't a QOA file
+inline int ReadQoaFileHeader(const unsigned char* bytes) {
+    uint64_t header = ReadQoaU64(bytes);
+    if((uint32_t) (header >> 32) != qoaMagic) {
+        return -1;
+    }
+    return (int) (header & 0xffffffff);
+}
+
+inline QoaFrameHeader ReadQoaFrameHeader(const unsigned char* bytes) {
+    uint64_t header = ReadQoaU64(bytes);
+
+    QoaFrameHeader frame;
+    frame.channels = (int) ((header >> 56) & 0xff);
+    frame.sampleRate = (int) ((header >> 32) & 0xffffff);
+    frame.samples = (int) ((header >> 16) & 0xffff);
+    frame.size = (int) (header & 0xffff);
+
+    return frame;
+}
+
+// Decodes one frame into interleaved samples, which need room for
+// qoaFrameLength samples per channel. Returns samples per channel,
+// or -1 when the frame is broken
+inline int DecodeQoaFrame(const unsigned char* bytes, int size, short* samples) {
+    if(size < qoaFrameHeaderSize) {
+        return -1;
+    }
+
+    QoaFrameHeader header = ReadQoaFrameHeader(bytes);
+    if(header.channels < 1 || header.channels > qoaMaxChannels || header.samples > qoaFrameLength ||
+       header.size > size || header.size < GetQoaFrameSize(header.channels, header.samples)) {
+        return -1;
+    }
+
+    const unsigned char* read = bytes + qoaFrameHeaderSize;
+    int channels = header.channels;
+
+    QoaLms lms[qoaMaxChannels];
+    for(int c = 0; c < channels; c++) {
+        uint64_t history = ReadQoaU64(read);
+        uint64_t weights = ReadQoaU64(read + 8);
+        read += 16;
+
+        for(int i = 0; i < qoaLmsLength; i++) {
+            lms[c].history[i] = (short) (history >> 48);
+            lms[c].weights[i] = (short) (weights >> 48);
+            history <<= 16;
+            weights <<= 16;
+        }
+    }
+
+    for(int start = 0; start < header.samples; start += qoaSliceLength) {
+        int end = start + qoaSliceLength < header.samples ? start + qoaSliceLength : header.samples;
+
+        for(int c = 0; c < channels; c++) {
+            uint64_t slice = ReadQoaU64(read);
+            read += 8;
+
+            const int* dequantize = qoaDequantize[slice >> 60];
+            slice <<= 4;
+
+            for(int i = start; i < end; i++) {
+                int residual = dequantize[slice >> 61];
+                int sample = ClampQoaSample(PredictQoaSample(&lms[c]) + residual);
+                slice <<= 3;
+
+                samples[i * channels + c] = (short) sample;
+                UpdateQoaLms(&lms[c], sample, residual);
+            }
+        }
+    }
+
+    return header.samples;
+}
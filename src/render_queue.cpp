@@ -0,0 +1,291 @@
+// Render queue. Everything drawn in a frame is submitted as an item,
+// items are sorted once by a 64 bit key, and drawn in that order with
+// depth writes switched and rlgl's batch flushed only where needed.
+// Key is built in render_queue.h, the tools check its order there.
+//
+// Key, from the most significant bits:
+//
+//   layer        8 bits   layers are drawn in order, UI ones in 2D
+//   blended      1 bit    items with depth write (opaque) go first, so
+//                         blended ones behind them are depth tested
+//                         away, and the ones in front are blended over
+//   then for items with depth write (opaque):
+//     material   16 bits  fewer texture and shader switches
+//     depth      32 bits  front to back
+//   and for items without depth write (blended):
+//     depth      32 bits  back to front
+//     material   16 bits
+//
+// Something that has to stay under everything else, without depth
+// testing against it, goes to an earlier layer.
+//
+// Billboards go through rlgl's batch, meshes are drawn right away. The
+// batch is flushed only before an item that doesn't go through it, and
+// before depth write changes, because the batch is drawn with whatever
+// state is current when it's flushed.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/raylib.h"
+#include "include/rlgl.h"
+#include "include/raymath.h"
+
+#include "render_queue.h"
+
+enum RenderItemType {
+    RENDER_ITEM_STATIC_MESH,
+    RENDER_ITEM_MESH,
+    RENDER_ITEM_BILLBOARD,
+    RENDER_ITEM_TEXT,
+};
+
+const int maxRenderItems = 256;
+
+struct RenderItem {
+    unsigned long long key;
+    // Submission order, keeps the sort stable
+    int order;
+
+    RenderItemType type;
+    RenderLayer layer;
+    bool depthWrite;
+
+    Matrix transform;
+    const StaticMesh* staticMesh;
+    const Mesh* mesh;
+    const Material* material;
+
+    Texture2D texture;
+    Rectangle source;
+    Vector3 position;
+    float size;
+    Color tint;
+
+    SdfFont* font;
+    const char* text;
+    int fontSize;
+};
+
+struct RenderQueue {
+    RenderItem items[maxRenderItems];
+    int count;
+
+    // Camera the depth is measured from
+    Vector3 viewPosition;
+    Vector3 viewDirection;
+
+    // Optional, item types are timed on the GPU as passes
+    GpuTimer* gpuTimer;
+};
+
+void ClearRenderQueue(RenderQueue* queue, const Camera* camera) {
+    queue->count = 0;
+    queue->viewPosition = camera->position;
+    queue->viewDirection = Vector3Normalize(Vector3Subtract(camera->target, camera->position));
+}
+
+RenderItem* AddRenderItem(RenderQueue* queue, RenderItemType type, RenderLayer layer, bool depthWrite,
+                          unsigned int material, Vector3 position) {
+    if(queue->count == maxRenderItems) {
+        TraceLog(LOG_WARNING, "Render queue is full, item dropped");
+        return NULL;
+    }
+
+    RenderItem* item = &queue->items[queue->count];
+    memset(item, 0, sizeof(*item));
+    item->order = queue->count++;
+    item->type = type;
+    item->layer = layer;
+    item->depthWrite = depthWrite;
+
+    float depth = Vector3DotProduct(Vector3Subtract(position, queue->viewPosition), queue->viewDirection);
+    item->key = GetRenderItemKey(layer, depthWrite, material, depth);
+
+    return item;
+}
+
+void SubmitStaticMesh(RenderQueue* queue, RenderLayer layer, bool depthWrite,
+                      const StaticMesh* mesh, Matrix transform) {
+    RenderItem* item = AddRenderItem(queue, RENDER_ITEM_STATIC_MESH, layer, depthWrite, 0,
+                                     { transform.m12, transform.m13, transform.m14 });
+    if(item) {
+        item->staticMesh = mesh;
+        item->transform = transform;
+    }
+}
+
+void SubmitMesh(RenderQueue* queue, RenderLayer layer, bool depthWrite,
+                const Mesh* mesh, const Material* material, Matrix transform) {
+    unsigned int materialKey = material->shader.id * 31 + material->maps[MATERIAL_MAP_DIFFUSE].texture.id;
+
+    RenderItem* item = AddRenderItem(queue, RENDER_ITEM_MESH, layer, depthWrite, materialKey,
+                                     { transform.m12, transform.m13, transform.m14 });
+    if(item) {
+        item->mesh = mesh;
+        item->material = material;
+        item->transform = transform;
+    }
+}
+
+// Billboards are blended, they never write depth. Source is
+// the part of the texture that's drawn, usually an atlas region
+void SubmitBillboard(RenderQueue* queue, RenderLayer layer, Texture2D texture, Rectangle source,
+                     Vector3 position, float size, Color tint) {
+    RenderItem* item = AddRenderItem(queue, RENDER_ITEM_BILLBOARD, layer, false, texture.id, position);
+    if(item) {
+        item->texture = texture;
+        item->source = source;
+        item->position = position;
+        item->size = size;
+        item->tint = tint;
+    }
+}
+
+// Text is drawn in the submission order within its layer. The string
+// isn't copied, it has to stay valid until the queue is drawn
+void SubmitText(RenderQueue* queue, RenderLayer layer, SdfFont* font, const char* text,
+                int x, int y, int fontSize, Color tint) {
+    RenderItem* item = AddRenderItem(queue, RENDER_ITEM_TEXT, layer, false, 0, queue->viewPosition);
+    if(item) {
+        item->font = font;
+        item->text = text;
+        item->position = { (float) x, (float) y, 0 };
+        item->fontSize = fontSize;
+        item->tint = tint;
+    }
+}
+
+GpuPass GetRenderItemPass(RenderItemType type) {
+    switch(type) {
+    case RENDER_ITEM_STATIC_MESH: return GPU_PASS_STATIC_MESHES;
+    case RENDER_ITEM_MESH:        return GPU_PASS_MESHES;
+    case RENDER_ITEM_BILLBOARD:   return GPU_PASS_BILLBOARDS;
+    case RENDER_ITEM_TEXT:        return GPU_PASS_TEXT;
+    }
+
+    return GPU_PASS_OTHER;
+}
+
+int CompareRenderItems(const void* a, const void* b) {
+    const RenderItem* itemA = (const RenderItem*) a;
+    const RenderItem* itemB = (const RenderItem*) b;
+
+    if(itemA->key != itemB->key) {
+        return itemA->key < itemB->key ? -1 : 1;
+    }
+
+    return itemA->order - itemB->order;
+}
+
+// BeginMode3D with matrices from the camera cache,
+// instead of building them again every frame
+void BeginCachedMode3D(CachedCamera* cached) {
+    UpdateCachedCamera(cached);
+
+    rlDrawRenderBatchActive();
+
+    rlMatrixMode(RL_PROJECTION);
+    rlPushMatrix();
+    rlLoadIdentity();
+    rlMultMatrixf(MatrixToFloat(cached->projection));
+
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+    rlMultMatrixf(MatrixToFloat(cached->view));
+
+    rlEnableDepthTest();
+}
+
+void SortRenderQueue(RenderQueue* queue) {
+    qsort(queue->items, queue->count, sizeof(RenderItem), CompareRenderItems);
+}
+
+// Draws items of the layers from first to last, the queue has to be
+// sorted. Layers can be drawn into different targets this way
+void DrawRenderLayers(RenderQueue* queue, CachedCamera* camera, RenderLayer first, RenderLayer last) {
+    bool in3D = false;
+
+    // Something was added to the batch and not drawn yet
+    bool batchPending = false;
+    bool depthWrite = true;
+
+    for(int i = 0; i < queue->count; i++) {
+        RenderItem* item = &queue->items[i];
+        if(item->layer < first || item->layer > last) {
+            continue;
+        }
+
+        if(queue->gpuTimer) {
+            GpuTimerSetPass(queue->gpuTimer, GetRenderItemPass(item->type));
+        }
+
+        if(in3D == false && item->layer < RENDER_LAYER_UI) {
+            BeginCachedMode3D(camera);
+            in3D = true;
+        }
+
+        if(in3D && item->layer >= RENDER_LAYER_UI) {
+            EndMode3D();
+            in3D = false;
+            batchPending = false;
+        }
+
+        bool batched = item->type == RENDER_ITEM_BILLBOARD || item->type == RENDER_ITEM_TEXT;
+
+        if(batchPending && (batched == false || item->depthWrite != depthWrite)) {
+            rlDrawRenderBatchActive();
+            batchPending = false;
+        }
+
+        if(in3D && item->depthWrite != depthWrite) {
+            if(item->depthWrite) {
+                rlEnableDepthMask();
+            }
+            else {
+                rlDisableDepthMask();
+            }
+
+            depthWrite = item->depthWrite;
+        }
+
+        switch(item->type) {
+        case RENDER_ITEM_STATIC_MESH:
+            DrawStaticMesh(item->staticMesh, item->transform);
+            break;
+        case RENDER_ITEM_MESH:
+            DrawMesh(*item->mesh, *item->material, item->transform);
+            break;
+        case RENDER_ITEM_BILLBOARD:
+            DrawBillboardRec(camera->camera, item->texture, item->source, item->position,
+                             { item->size, item->size }, item->tint);
+            break;
+        case RENDER_ITEM_TEXT:
+            // Text switches to its shader, which flushes the batch anyway
+            DrawSdfText(item->font, item->text, (int) item->position.x, (int) item->position.y,
+                        item->fontSize, item->tint);
+            break;
+        }
+
+        batchPending = batched && item->type != RENDER_ITEM_TEXT;
+    }
+
+    if(in3D) {
+        EndMode3D();
+    }
+
+    if(depthWrite == false) {
+        rlEnableDepthMask();
+    }
+
+    if(queue->gpuTimer) {
+        GpuTimerSetPass(queue->gpuTimer, GPU_PASS_OTHER);
+    }
+}
+
+void DrawRenderQueue(RenderQueue* queue, CachedCamera* camera) {
+    SortRenderQueue(queue);
+    DrawRenderLayers(queue, camera, RENDER_LAYER_BACKGROUND, RENDER_LAYER_UI);
+
+    queue->count = 0;
+}
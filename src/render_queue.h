@@ -0,0 +1,42 @@
+// Sort key of the render queue items, see render_queue.cpp. Apart from
+// the queue, it's used by the checks tool, which has no raylib.
+
+#pragma once
+
+#include <string.h>
+
+enum RenderLayer {
+    RENDER_LAYER_BACKGROUND,
+    RENDER_LAYER_WORLD,
+
+    // Layers from here on are drawn in 2D, after the 3D mode ends
+    RENDER_LAYER_UI,
+};
+
+// Float bits of a non-negative float sort the same as the float
+inline unsigned int GetDepthBits(float depth) {
+    depth = depth > 0 ? depth : 0;
+
+    unsigned int bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits;
+}
+
+// Depth is the distance from the camera along its view direction
+inline unsigned long long GetRenderItemKey(RenderLayer layer, bool depthWrite, unsigned int material, float depth) {
+    unsigned long long depthBits = GetDepthBits(depth);
+    unsigned long long materialBits = material & 0xffff;
+
+    unsigned long long key = (unsigned long long) layer << 56;
+    if(depthWrite) {
+        key |= materialBits << 32;
+        key |= depthBits;
+    }
+    else {
+        key |= 1ull << 55;
+        key |= (0xffffffffull - depthBits) << 16;
+        key |= materialBits;
+    }
+
+    return key;
+}
@@ -0,0 +1,180 @@
+// Recording and replaying of game sessions. The log has a small header
+// with the random seed, followed by one record per rendered frame:
+//
+//   u8  step count       u8  button edges (bit 0 pressed, bit 1 released)
+//   f32 frame delta      f32 x2 mouse position on screen
+//   step count x (f32 x3 pointer position, f32 x3 pointer direction)
+//
+// Inputs are stored exactly as the simulation steps got them, so a replay
+// runs the same steps with the same numbers, with or without a window.
+// Values are written in native byte order, all our targets are little endian.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "include/raylib.h"
+
+const char replayMagic[4] = { 'S', 'T', 'F', 'R' };
+const uint32_t replayVersion = 1;
+
+// Step count is stored in a byte
+const int replayMaxSteps = 255;
+
+const uint8_t replayMousePressed  = 1 << 0;
+const uint8_t replayMouseReleased = 1 << 1;
+
+struct ReplayHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t seed;
+    float simulationRate;
+};
+
+struct ReplayFrame {
+    float frameDelta;
+    Vector2 mousePosition;
+
+    // Button edges, they belong to the first step of the frame
+    bool mousePressed;
+    bool mouseReleased;
+
+    int stepCount;
+    GameInput steps[replayMaxSteps];
+};
+
+struct ReplayFile {
+    FILE* file;
+    ReplayHeader header;
+    long long frameIndex;
+};
+
+bool WriteFloats(FILE* file, const float* values, int count) {
+    return fwrite(values, sizeof(float), count, file) == (size_t) count;
+}
+
+bool ReadFloats(FILE* file, float* values, int count) {
+    return fread(values, sizeof(float), count, file) == (size_t) count;
+}
+
+bool OpenReplayRecorder(ReplayFile* replay, const char* path, unsigned int seed) {
+    memset(replay, 0, sizeof(*replay));
+
+    replay->file = fopen(path, "wb");
+    if(replay->file == NULL) {
+        printf("Failed to open replay file %s for writing\n", path);
+        return false;
+    }
+
+    memcpy(replay->header.magic, replayMagic, sizeof(replayMagic));
+    replay->header.version = replayVersion;
+    replay->header.seed = seed;
+    replay->header.simulationRate = simulationRate;
+
+    fwrite(&replay->header, sizeof(replay->header), 1, replay->file);
+
+    return true;
+}
+
+bool OpenReplayPlayer(ReplayFile* replay, const char* path) {
+    memset(replay, 0, sizeof(*replay));
+
+    replay->file = fopen(path, "rb");
+    if(replay->file == NULL) {
+        printf("Failed to open replay file %s\n", path);
+        return false;
+    }
+
+    ReplayHeader* header = &replay->header;
+    bool valid = fread(header, sizeof(*header), 1, replay->file) == 1 &&
+                 memcmp(header->magic, replayMagic, sizeof(replayMagic)) == 0;
+
+    if(valid == false) {
+        printf("%s is not a replay file\n", path);
+    }
+    else if(header->version != replayVersion) {
+        printf("Replay %s has version %u, expected %u\n", path, header->version, replayVersion);
+        valid = false;
+    }
+    else if(header->simulationRate != simulationRate) {
+        printf("Replay %s was recorded with simulation rate %.0f, current is %.0f\n",
+               path, header->simulationRate, simulationRate);
+        valid = false;
+    }
+
+    if(valid == false) {
+        fclose(replay->file);
+        replay->file = NULL;
+    }
+
+    return valid;
+}
+
+void CloseReplay(ReplayFile* replay) {
+    if(replay->file) {
+        fclose(replay->file);
+        replay->file = NULL;
+    }
+}
+
+void WriteReplayFrame(ReplayFile* replay, const ReplayFrame* frame) {
+    uint8_t stepCount = (uint8_t) frame->stepCount;
+    uint8_t edges = (frame->mousePressed  ? replayMousePressed  : 0) |
+                    (frame->mouseReleased ? replayMouseReleased : 0);
+
+    fwrite(&stepCount, 1, 1, replay->file);
+    fwrite(&edges, 1, 1, replay->file);
+
+    float values[6] = { frame->frameDelta, frame->mousePosition.x, frame->mousePosition.y };
+    WriteFloats(replay->file, values, 3);
+
+    for(int i = 0; i < frame->stepCount; i++) {
+        const GameInput* step = &frame->steps[i];
+        values[0] = step->pointerPosition.x;
+        values[1] = step->pointerPosition.y;
+        values[2] = step->pointerPosition.z;
+        values[3] = step->pointerDirection.x;
+        values[4] = step->pointerDirection.y;
+        values[5] = step->pointerDirection.z;
+
+        WriteFloats(replay->file, values, 6);
+    }
+
+    replay->frameIndex++;
+}
+
+// Returns false at the end of the log. Partially written
+// last frame, e.g. after a crash, is ignored
+bool ReadReplayFrame(ReplayFile* replay, ReplayFrame* frame) {
+    uint8_t stepCount;
+    uint8_t edges;
+    float values[6];
+
+    if(fread(&stepCount, 1, 1, replay->file) != 1 ||
+       fread(&edges, 1, 1, replay->file) != 1 ||
+       ReadFloats(replay->file, values, 3) == false) {
+        return false;
+    }
+
+    frame->frameDelta = values[0];
+    frame->mousePosition = { values[1], values[2] };
+    frame->mousePressed  = (edges & replayMousePressed) != 0;
+    frame->mouseReleased = (edges & replayMouseReleased) != 0;
+    frame->stepCount = stepCount;
+
+    for(int i = 0; i < frame->stepCount; i++) {
+        if(ReadFloats(replay->file, values, 6) == false) {
+            return false;
+        }
+
+        GameInput* step = &frame->steps[i];
+        step->pointerPosition  = { values[0], values[1], values[2] };
+        step->pointerDirection = { values[3], values[4], values[5] };
+        step->mousePressed  = i == 0 && frame->mousePressed;
+        step->mouseReleased = i == 0 && frame->mouseReleased;
+    }
+
+    replay->frameIndex++;
+
+    return true;
+}
@@ -0,0 +1,395 @@
+// Large text drawn from a signed distance field atlas. raylib's default
+// font is a 10 px bitmap, and DrawText at size 70 or 110 just magnifies
+// it. Here every glyph of that font is baked at startup into a distance
+// field, sampled with bilinear filtering and cut at the edge by a shader,
+// so the text keeps its pixel look, with edges sharp at any size.
+//
+// Layout of a string (quad positions and width) is cached by string hash
+// and size, so measuring and drawing the same text again doesn't walk it.
+// Metrics match DrawText / MeasureText with the default font.
+
+#include <math.h>
+#include <string.h>
+
+#include "include/raylib.h"
+#include "include/rlgl.h"
+#include "include/raymath.h"
+
+// Atlas pixels per font texel, and the distance field
+// spread around every glyph, in atlas pixels
+const int sdfGlyphScale = 8;
+const int sdfPadding = 4;
+
+const int sdfFirstChar = 32;
+const int sdfLastChar = 126;
+const int sdfGlyphCount = sdfLastChar - sdfFirstChar + 1;
+
+const int sdfAtlasWidth = 1024;
+
+const int sdfLayoutCacheSize = 16;
+const int sdfMaxLayoutQuads = 256;
+
+#if WEB_BUILD
+const char* sdfFragmentShader = R"###(#version 100
+precision mediump float;
+
+varying vec2 fragTexCoord;
+varying vec4 fragColor;
+
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform float smoothing;
+
+void main() {
+    float distance = texture2D(texture0, fragTexCoord).r;
+    float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+    gl_FragColor = vec4(fragColor.rgb, fragColor.a * alpha) * colDiffuse;
+}
+)###";
+#else
+const char* sdfFragmentShader = R"###(#version 330
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform float smoothing;
+
+out vec4 finalColor;
+
+void main() {
+    float distance = texture(texture0, fragTexCoord).r;
+    float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+    finalColor = vec4(fragColor.rgb, fragColor.a * alpha) * colDiffuse;
+}
+)###";
+#endif
+
+struct SdfGlyph {
+    // Cell in the atlas, with padding
+    Rectangle source;
+    // Size in font texels, without padding
+    int width;
+    int height;
+};
+
+struct SdfQuad {
+    Rectangle dest;
+    Rectangle source;
+};
+
+struct SdfTextLayout {
+    unsigned int hash;
+    int fontSize;
+    char text[sdfMaxLayoutQuads + 64];
+
+    int width;
+    int quadCount;
+    SdfQuad quads[sdfMaxLayoutQuads];
+
+    unsigned int lastUse;
+};
+
+struct SdfFont {
+    Texture2D atlas;
+    Shader shader;
+    int smoothingLoc;
+
+    int baseSize;
+    SdfGlyph glyphs[sdfGlyphCount];
+
+    SdfTextLayout layouts[sdfLayoutCacheSize];
+    unsigned int useCounter;
+};
+
+// Distance from a point to the texel square, 0 inside of it
+float DistanceToTexel(float x, float y, int tx, int ty) {
+    float dx = fmaxf(fmaxf(tx - x, x - (tx + 1)), 0);
+    float dy = fmaxf(fmaxf(ty - y, y - (ty + 1)), 0);
+    return sqrtf(dx * dx + dy * dy);
+}
+
+// Default font glyphs are at most 10x10 texels
+const int sdfMaxGlyphTexels = 16;
+
+struct GlyphMask {
+    int width;
+    int height;
+    bool filled[sdfMaxGlyphTexels * sdfMaxGlyphTexels];
+};
+
+bool IsTexelFilled(GlyphMask* mask, int x, int y) {
+    if(x < 0 || y < 0 || x >= mask->width || y >= mask->height) {
+        return false;
+    }
+
+    return mask->filled[y * mask->width + x];
+}
+
+// Writes distance field of one glyph into the atlas. Value 0.5 is the
+// edge, 0 and 1 are half of a texel outside and inside of it
+void BakeSdfGlyph(Image* glyphImage, unsigned char* atlas, int cellX, int cellY) {
+    GlyphMask mask = {};
+    mask.width = glyphImage->width < sdfMaxGlyphTexels ? glyphImage->width : sdfMaxGlyphTexels;
+    mask.height = glyphImage->height < sdfMaxGlyphTexels ? glyphImage->height : sdfMaxGlyphTexels;
+
+    for(int y = 0; y < mask.height; y++) {
+        for(int x = 0; x < mask.width; x++) {
+            mask.filled[y * mask.width + x] = GetImageColor(*glyphImage, x, y).a > 127;
+        }
+    }
+
+    int cellWidth = mask.width * sdfGlyphScale + sdfPadding * 2;
+    int cellHeight = mask.height * sdfGlyphScale + sdfPadding * 2;
+
+    const float spread = (float) sdfPadding / sdfGlyphScale;
+
+    for(int y = 0; y < cellHeight; y++) {
+        for(int x = 0; x < cellWidth; x++) {
+            // Pixel center in font texels
+            float gx = (x + 0.5f - sdfPadding) / sdfGlyphScale;
+            float gy = (y + 0.5f - sdfPadding) / sdfGlyphScale;
+            int tx = (int) floorf(gx);
+            int ty = (int) floorf(gy);
+
+            bool inside = IsTexelFilled(&mask, tx, ty);
+
+            // Spread is under one texel, so the closest texel
+            // of the other kind is always one of the neighbours
+            float distance = spread;
+            for(int ny = ty - 1; ny <= ty + 1; ny++) {
+                for(int nx = tx - 1; nx <= tx + 1; nx++) {
+                    if(IsTexelFilled(&mask, nx, ny) != inside) {
+                        distance = fminf(distance, DistanceToTexel(gx, gy, nx, ny));
+                    }
+                }
+            }
+
+            float value = 0.5f + (inside ? distance : -distance) / (2 * spread);
+            atlas[(cellY + y) * sdfAtlasWidth + cellX + x] = (unsigned char) Clamp(value * 255.0f + 0.5f, 0, 255);
+        }
+    }
+}
+
+SdfFont* LoadSdfFont() {
+    SdfFont* sdf = (SdfFont*) MemAlloc(sizeof(SdfFont));
+
+    Font font = GetFontDefault();
+    sdf->baseSize = font.baseSize;
+
+    // Row packing, all glyphs of the default font have the same height
+    int cellHeight = 0;
+    int x = 0;
+    int y = 0;
+    for(int i = 0; i < sdfGlyphCount; i++) {
+        int index = GetGlyphIndex(font, sdfFirstChar + i);
+        Rectangle rec = font.recs[index];
+
+        int w = (int) rec.width * sdfGlyphScale + sdfPadding * 2;
+        int h = (int) rec.height * sdfGlyphScale + sdfPadding * 2;
+
+        if(x + w > sdfAtlasWidth) {
+            x = 0;
+            y += cellHeight;
+            cellHeight = 0;
+        }
+
+        SdfGlyph* glyph = &sdf->glyphs[i];
+        glyph->source = { (float) x, (float) y, (float) w, (float) h };
+        glyph->width = (int) rec.width;
+        glyph->height = (int) rec.height;
+
+        x += w;
+        cellHeight = h > cellHeight ? h : cellHeight;
+    }
+
+    int atlasHeight = 1;
+    while(atlasHeight < y + cellHeight) {
+        atlasHeight *= 2;
+    }
+
+    Image atlas = {};
+    atlas.data = MemAlloc(sdfAtlasWidth * atlasHeight);
+    atlas.width = sdfAtlasWidth;
+    atlas.height = atlasHeight;
+    atlas.mipmaps = 1;
+    atlas.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+
+    for(int i = 0; i < sdfGlyphCount; i++) {
+        Image* glyphImage = &font.glyphs[GetGlyphIndex(font, sdfFirstChar + i)].image;
+        Rectangle source = sdf->glyphs[i].source;
+
+        BakeSdfGlyph(glyphImage, (unsigned char*) atlas.data, (int) source.x, (int) source.y);
+    }
+
+    sdf->atlas = LoadTextureFromImage(atlas);
+    SetTextureFilter(sdf->atlas, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(atlas);
+
+    // Default vertex shader is fine
+    sdf->shader = LoadShaderFromMemory(NULL, sdfFragmentShader);
+    sdf->smoothingLoc = GetShaderLocation(sdf->shader, "smoothing");
+
+    return sdf;
+}
+
+void UnloadSdfFont(SdfFont* sdf) {
+    UnloadTexture(sdf->atlas);
+    UnloadShader(sdf->shader);
+    MemFree(sdf);
+}
+
+unsigned int HashText(const char* text) {
+    unsigned int hash = 2166136261u;
+    for(const char* c = text; *c; c++) {
+        hash = (hash ^ (unsigned char) *c) * 16777619u;
+    }
+
+    return hash;
+}
+
+SdfGlyph* GetSdfGlyph(SdfFont* sdf, char c) {
+    if(c < sdfFirstChar || c > sdfLastChar) {
+        c = '?';
+    }
+
+    return &sdf->glyphs[c - sdfFirstChar];
+}
+
+// Quads of the text relative to its position. Spacing, line height and
+// width are the same as DrawText and MeasureText use
+void LayoutSdfText(SdfFont* sdf, SdfTextLayout* layout, const char* text, int fontSize) {
+    float scale = (float) fontSize / sdf->baseSize;
+    float spacing = (float) (fontSize / sdf->baseSize);
+    float padding = (float) sdfPadding / sdfGlyphScale * scale;
+
+    float x = 0;
+    float y = 0;
+    int lineTexels = 0;
+    int lineLength = 0;
+
+    layout->width = 0;
+    layout->quadCount = 0;
+
+    for(const char* c = text; ; c++) {
+        if(*c == '\n' || *c == '\0') {
+            int lineWidth = (int) (lineTexels * scale + (lineLength - 1) * spacing);
+            layout->width = lineWidth > layout->width ? lineWidth : layout->width;
+
+            if(*c == '\0') {
+                break;
+            }
+
+            x = 0;
+            y += (int) ((sdf->baseSize + sdf->baseSize / 2.0f) * scale);
+            lineTexels = 0;
+            lineLength = 0;
+            continue;
+        }
+
+        SdfGlyph* glyph = GetSdfGlyph(sdf, *c);
+
+        if(*c != ' ' && *c != '\t' && layout->quadCount < sdfMaxLayoutQuads) {
+            SdfQuad* quad = &layout->quads[layout->quadCount++];
+            quad->dest = { x - padding, y - padding,
+                           glyph->width * scale + padding * 2, glyph->height * scale + padding * 2 };
+            quad->source = glyph->source;
+        }
+
+        x += glyph->width * scale + spacing;
+        lineTexels += glyph->width;
+        lineLength++;
+    }
+}
+
+// Cached layout of the text, evicts the least recently used one
+SdfTextLayout* GetSdfTextLayout(SdfFont* sdf, const char* text, int fontSize) {
+    unsigned int hash = HashText(text);
+    sdf->useCounter++;
+
+    SdfTextLayout* oldest = &sdf->layouts[0];
+    for(int i = 0; i < sdfLayoutCacheSize; i++) {
+        SdfTextLayout* layout = &sdf->layouts[i];
+
+        if(layout->lastUse != 0 && layout->hash == hash && layout->fontSize == fontSize &&
+           strcmp(layout->text, text) == 0) {
+            layout->lastUse = sdf->useCounter;
+            return layout;
+        }
+
+        if(layout->lastUse < oldest->lastUse) {
+            oldest = layout;
+        }
+    }
+
+    // Texts too long for the cache are laid out every time in the evicted slot
+    SdfTextLayout* layout = oldest;
+    bool fits = strlen(text) < sizeof(layout->text);
+
+    layout->hash = hash;
+    layout->fontSize = fontSize;
+    layout->text[0] = '\0';
+    if(fits) {
+        strcpy(layout->text, text);
+    }
+    layout->lastUse = fits ? sdf->useCounter : 0;
+
+    LayoutSdfText(sdf, layout, text, fontSize);
+
+    return layout;
+}
+
+int MeasureSdfText(SdfFont* sdf, const char* text, int fontSize) {
+    return GetSdfTextLayout(sdf, text, fontSize)->width;
+}
+
+void DrawSdfText(SdfFont* sdf, const char* text, int posX, int posY, int fontSize, Color color) {
+    SdfTextLayout* layout = GetSdfTextLayout(sdf, text, fontSize);
+    if(layout->quadCount == 0) {
+        return;
+    }
+
+    // Smoothing is in units of the distance field, which spans
+    // one font texel. Edge is blended over one screen pixel
+    float smoothing = 0.5f * sdf->baseSize / fontSize;
+
+    BeginShaderMode(sdf->shader);
+    SetShaderValue(sdf->shader, sdf->smoothingLoc, &smoothing, SHADER_UNIFORM_FLOAT);
+
+    rlCheckRenderBatchLimit(layout->quadCount * 4);
+    rlSetTexture(sdf->atlas.id);
+
+    float atlasWidth = (float) sdf->atlas.width;
+    float atlasHeight = (float) sdf->atlas.height;
+
+    rlBegin(RL_QUADS);
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+
+    for(int i = 0; i < layout->quadCount; i++) {
+        Rectangle d = layout->quads[i].dest;
+        Rectangle s = layout->quads[i].source;
+
+        d.x += posX;
+        d.y += posY;
+
+        rlTexCoord2f(s.x / atlasWidth, s.y / atlasHeight);
+        rlVertex2f(d.x, d.y);
+
+        rlTexCoord2f(s.x / atlasWidth, (s.y + s.height) / atlasHeight);
+        rlVertex2f(d.x, d.y + d.height);
+
+        rlTexCoord2f((s.x + s.width) / atlasWidth, (s.y + s.height) / atlasHeight);
+        rlVertex2f(d.x + d.width, d.y + d.height);
+
+        rlTexCoord2f((s.x + s.width) / atlasWidth, s.y / atlasHeight);
+        rlVertex2f(d.x + d.width, d.y);
+    }
+
+    rlEnd();
+    rlSetTexture(0);
+
+    // Smoothing of the next text may differ, so the batch is flushed here
+    EndShaderMode();
+}
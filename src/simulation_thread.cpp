@@ -0,0 +1,309 @@
+// Simulation thread. The main thread gathers input of a frame and hands
+// it over, steps of it run on this thread, and the result is published
+// as a snapshot, which the main thread draws while the next frame is
+// being simulated already:
+//
+//   main thread                              simulation thread
+//   GatherFrameInput  -- frame queue -->     UpdateSimulation per step
+//   HandleGameEvents  <-- event queue --     merged events of a frame
+//   DrawGame          <-- triple buffer --   GameSnapshot
+//
+// Queues are single producer / single consumer, like the pointer one.
+// Snapshots go through a triple buffer, so the simulation always has a
+// slot to write into and the renderer always takes the newest one,
+// without waiting for each other. Snapshots in between can be skipped,
+// events can't, so they have their own queue.
+//
+// Once started, game state belongs to the simulation thread, the main
+// thread only reads snapshots. Web builds have no threads, steps are
+// run right when the frame is pushed.
+
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+#if !WEB_BUILD
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "include/raylib.h"
+
+// Must be powers of two
+const unsigned int simulationFrameQueueSize = 4;
+const unsigned int gameEventQueueSize = 64;
+
+// Everything the main thread needs to draw a frame
+struct GameSnapshot {
+    RenderState previous;
+    RenderState current;
+    // Simulation time of the current state
+    double time;
+    // GetTime() when the input of the frame was gathered, the
+    // state is interpolated up to one step before it
+    double inputTime;
+
+    bool isInMenu;
+    bool foxHit;
+    bool handFollowsPointer;
+
+    // Until the fox jumps again, 0 while it's jumping
+    float foxJumpDelay;
+    float screamVolume;
+
+    char resultText[resultTextSize];
+};
+
+// Events merged over a frame, with what's needed to play the sounds
+struct GameEventMessage {
+    GameEvents events;
+
+    int hitSoundIndex;
+    int screamIndex;
+    float screamPitch;
+};
+
+struct SimulationFrame {
+    ReplayFrame input;
+    // Simulation time after the last step of the frame
+    double time;
+    double inputTime;
+};
+
+template <typename T, unsigned int Size>
+struct SpscQueue {
+    T items[Size];
+
+    // Written only by the producer / consumer respectively
+    std::atomic<unsigned int> head;
+    std::atomic<unsigned int> tail;
+};
+
+template <typename T, unsigned int Size>
+T* BeginQueuePush(SpscQueue<T, Size>* queue) {
+    unsigned int head = queue->head.load(std::memory_order_relaxed);
+    unsigned int tail = queue->tail.load(std::memory_order_acquire);
+
+    if(head - tail == Size) {
+        return NULL;
+    }
+
+    return &queue->items[head & (Size - 1)];
+}
+
+template <typename T, unsigned int Size>
+void EndQueuePush(SpscQueue<T, Size>* queue) {
+    queue->head.store(queue->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename T, unsigned int Size>
+T* PeekQueue(SpscQueue<T, Size>* queue) {
+    unsigned int tail = queue->tail.load(std::memory_order_relaxed);
+    unsigned int head = queue->head.load(std::memory_order_acquire);
+
+    if(tail == head) {
+        return NULL;
+    }
+
+    return &queue->items[tail & (Size - 1)];
+}
+
+template <typename T, unsigned int Size>
+void PopQueue(SpscQueue<T, Size>* queue) {
+    queue->tail.store(queue->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Slot index in the middle, with this bit set when it's
+// newer than the one the renderer has
+const int snapshotFreshBit = 4;
+
+struct SimulationThread {
+    SpscQueue<SimulationFrame, simulationFrameQueueSize> frames;
+    SpscQueue<GameEventMessage, gameEventQueueSize> events;
+
+    GameSnapshot snapshots[3];
+    std::atomic<int> middle;
+    // Slots owned by the simulation / renderer
+    int back;
+    int front;
+
+    // Owned by the simulation thread
+    RenderState previousState;
+    RenderState currentState;
+
+#if !WEB_BUILD
+    std::atomic<bool> running;
+    std::thread thread;
+
+    // Only for waking the simulation up, data goes through the queues
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+#endif
+};
+
+void CaptureGameSnapshot(SimulationThread* simulation, GameSnapshot* snapshot, double time, double inputTime) {
+    snapshot->previous = simulation->previousState;
+    snapshot->current = simulation->currentState;
+    snapshot->time = time;
+    snapshot->inputTime = inputTime;
+
+    snapshot->isInMenu = isInMenu;
+    snapshot->foxHit = foxHit;
+    snapshot->handFollowsPointer = isInMenu == false && handGrabbed && foxHit == false;
+
+    snapshot->foxJumpDelay = GetFoxJumpDelay(&foxAnimationState);
+    snapshot->screamVolume = screamVolume;
+
+    memcpy(snapshot->resultText, resultText, sizeof(snapshot->resultText));
+}
+
+void PublishSnapshot(SimulationThread* simulation) {
+    int previous = simulation->middle.exchange(simulation->back | snapshotFreshBit, std::memory_order_acq_rel);
+    simulation->back = previous & ~snapshotFreshBit;
+}
+
+// Newest published snapshot, valid until the next call
+const GameSnapshot* AcquireSnapshot(SimulationThread* simulation) {
+    if(simulation->middle.load(std::memory_order_relaxed) & snapshotFreshBit) {
+        int previous = simulation->middle.exchange(simulation->front, std::memory_order_acq_rel);
+        simulation->front = previous & ~snapshotFreshBit;
+    }
+
+    return &simulation->snapshots[simulation->front];
+}
+
+void PushGameEvents(SimulationThread* simulation) {
+    if(gameEvents.foxHit == false && gameEvents.gameReset == false &&
+       gameEvents.handGrabbed == false && gameEvents.handReleased == false) {
+        return;
+    }
+
+    // Main thread empties the queue every frame, it's never full for long
+    GameEventMessage* message;
+    while((message = BeginQueuePush(&simulation->events)) == NULL) {
+#if !WEB_BUILD
+        std::this_thread::yield();
+#endif
+    }
+
+    message->events = gameEvents;
+    message->hitSoundIndex = currentHitSoundIndex;
+    message->screamIndex = currentScreamIndex;
+    message->screamPitch = screamPitch;
+    EndQueuePush(&simulation->events);
+
+    gameEvents = {};
+}
+
+// Runs all queued frames, publishes the snapshot after each
+void RunSimulationFrames(SimulationThread* simulation) {
+    SimulationFrame* frame;
+    while((frame = PeekQueue(&simulation->frames)) != NULL) {
+        for(int i = 0; i < frame->input.stepCount; i++) {
+            simulation->previousState = simulation->currentState;
+            UpdateSimulation(&frame->input.steps[i], simulationDeltaTime);
+            simulation->currentState = CaptureRenderState();
+        }
+
+        double time = frame->time;
+        double inputTime = frame->inputTime;
+        PopQueue(&simulation->frames);
+
+        PushGameEvents(simulation);
+
+        CaptureGameSnapshot(simulation, &simulation->snapshots[simulation->back], time, inputTime);
+        PublishSnapshot(simulation);
+    }
+}
+
+#if !WEB_BUILD
+void SimulationThreadMain(SimulationThread* simulation) {
+    while(simulation->running.load(std::memory_order_relaxed)) {
+        {
+            std::unique_lock<std::mutex> lock(simulation->wakeMutex);
+            simulation->wake.wait(lock, [simulation] {
+                return PeekQueue(&simulation->frames) != NULL ||
+                       simulation->running.load(std::memory_order_relaxed) == false;
+            });
+        }
+
+        RunSimulationFrames(simulation);
+    }
+}
+#endif
+
+// Game has to be initialized already, from here on it's
+// updated only through PushSimulationFrame
+void StartSimulationThread(SimulationThread* simulation, double time) {
+    simulation->currentState = CaptureRenderState();
+    simulation->previousState = simulation->currentState;
+
+    for(int i = 0; i < 3; i++) {
+        CaptureGameSnapshot(simulation, &simulation->snapshots[i], time, time);
+    }
+
+    simulation->back = 0;
+    simulation->middle = 1;
+    simulation->front = 2;
+
+#if !WEB_BUILD
+    simulation->running = true;
+    simulation->thread = std::thread(SimulationThreadMain, simulation);
+#endif
+}
+
+void StopSimulationThread(SimulationThread* simulation) {
+#if !WEB_BUILD
+    {
+        std::lock_guard<std::mutex> lock(simulation->wakeMutex);
+        simulation->running = false;
+    }
+    simulation->wake.notify_one();
+
+    if(simulation->thread.joinable()) {
+        simulation->thread.join();
+    }
+#endif
+}
+
+// Copies only the steps the frame has. Waits when the simulation
+// is a whole queue behind, input of a frame can't be dropped
+void PushSimulationFrame(SimulationThread* simulation, const ReplayFrame* input, double time, double inputTime) {
+    SimulationFrame* frame;
+    while((frame = BeginQueuePush(&simulation->frames)) == NULL) {
+#if !WEB_BUILD
+        std::this_thread::yield();
+#endif
+    }
+
+    memcpy(&frame->input, input, offsetof(ReplayFrame, steps));
+    memcpy(frame->input.steps, input->steps, input->stepCount * sizeof(GameInput));
+    frame->time = time;
+    frame->inputTime = inputTime;
+
+    EndQueuePush(&simulation->frames);
+
+#if WEB_BUILD
+    RunSimulationFrames(simulation);
+#else
+    {
+        // Taking the lock makes sure the wake up isn't missed
+        std::lock_guard<std::mutex> lock(simulation->wakeMutex);
+    }
+    simulation->wake.notify_one();
+#endif
+}
+
+// Returns false when there are no more events
+bool PopGameEvents(SimulationThread* simulation, GameEventMessage* message) {
+    GameEventMessage* front = PeekQueue(&simulation->events);
+    if(front == NULL) {
+        return false;
+    }
+
+    *message = *front;
+    PopQueue(&simulation->events);
+
+    return true;
+}
@@ -0,0 +1,133 @@
+// Geometry that never changes, uploaded to the GPU once and drawn with
+// a single call. Everything drawn through DrawGrid, DrawLine3D and
+// friends is pushed vertex by vertex into rlgl's batch every frame,
+// which is wasteful for scenery, so the batch should only get what
+// actually moves.
+//
+// Vertices have position and color and are drawn with the default shader,
+// as lines or triangles (any RL_LINES / RL_TRIANGLES primitive).
+
+#include <stddef.h>
+
+#include "include/raylib.h"
+#include "include/rlgl.h"
+#include "include/raymath.h"
+
+#include "opengl.h"
+
+struct StaticVertex {
+    Vector3 position;
+    Color color;
+};
+
+struct StaticMesh {
+    unsigned int vao;
+    unsigned int vbo;
+    int vertexCount;
+    int primitive;
+};
+
+// Points the position and color attributes of the default
+// shader at the currently bound vertex buffer
+void SetStaticVertexAttributes() {
+    int* locs = rlGetShaderLocsDefault();
+
+    rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION], 3, RL_FLOAT, false,
+                         sizeof(StaticVertex), (void*) offsetof(StaticVertex, position));
+    rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION]);
+
+    rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR], 4, RL_UNSIGNED_BYTE, true,
+                         sizeof(StaticVertex), (void*) offsetof(StaticVertex, color));
+    rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR]);
+}
+
+StaticMesh LoadStaticMesh(const StaticVertex* vertices, int vertexCount, int primitive) {
+    StaticMesh mesh = {};
+    mesh.vertexCount = vertexCount;
+    mesh.primitive = primitive;
+
+    // No VAO on WebGL 1 without the extension, then the
+    // attributes are set up again on every draw
+    mesh.vao = rlLoadVertexArray();
+    bool hasVao = rlEnableVertexArray(mesh.vao);
+
+    mesh.vbo = rlLoadVertexBuffer(vertices, vertexCount * sizeof(StaticVertex), false);
+
+    if(hasVao) {
+        SetStaticVertexAttributes();
+        rlDisableVertexArray();
+    }
+
+    rlDisableVertexBuffer();
+
+    return mesh;
+}
+
+void UnloadStaticMesh(StaticMesh* mesh) {
+    if(mesh->vao) {
+        rlUnloadVertexArray(mesh->vao);
+    }
+
+    rlUnloadVertexBuffer(mesh->vbo);
+    *mesh = {};
+}
+
+// Draws right away, not through the batch. Whatever was batched
+// before is flushed first, so the draw order stays the same
+void DrawStaticMesh(const StaticMesh* mesh, Matrix transform) {
+    rlDrawRenderBatchActive();
+
+    int* locs = rlGetShaderLocsDefault();
+    rlEnableShader(rlGetShaderIdDefault());
+
+    Matrix mvp = MatrixMultiply(MatrixMultiply(transform, rlGetMatrixModelview()), rlGetMatrixProjection());
+    rlSetUniformMatrix(locs[RL_SHADER_LOC_MATRIX_MVP], mvp);
+
+    float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    rlSetUniform(locs[RL_SHADER_LOC_COLOR_DIFFUSE], white, RL_SHADER_UNIFORM_VEC4, 1);
+
+    // Default shader samples a texture, the 1x1 white one leaves colors as they are
+    int textureSlot = 0;
+    rlActiveTextureSlot(0);
+    rlEnableTexture(rlGetTextureIdDefault());
+    rlSetUniform(locs[RL_SHADER_LOC_MAP_DIFFUSE], &textureSlot, RL_SHADER_UNIFORM_INT, 1);
+
+    if(rlEnableVertexArray(mesh->vao) == false) {
+        rlEnableVertexBuffer(mesh->vbo);
+        SetStaticVertexAttributes();
+    }
+
+    glDrawArrays(mesh->primitive, 0, mesh->vertexCount);
+
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+    rlDisableTexture();
+    rlDisableShader();
+}
+
+// Same lines as DrawGrid(slices, spacing)
+StaticMesh LoadGridMesh(int slices, float spacing) {
+    int halfSlices = slices / 2;
+    int vertexCount = (halfSlices * 2 + 1) * 4;
+
+    StaticVertex* vertices = (StaticVertex*) MemAlloc(vertexCount * sizeof(StaticVertex));
+    StaticVertex* v = vertices;
+
+    float extent = halfSlices * spacing;
+
+    for(int i = -halfSlices; i <= halfSlices; i++) {
+        // Colors DrawGrid gets from rlColor3f(0.5f, ...) and rlColor3f(0.75f, ...)
+        Color color = i == 0 ? Color{ 127, 127, 127, 255 } : Color{ 191, 191, 191, 255 };
+        float offset = i * spacing;
+
+        *v++ = { { offset, 0, -extent }, color };
+        *v++ = { { offset, 0,  extent }, color };
+        *v++ = { { -extent, 0, offset }, color };
+        *v++ = { {  extent, 0, offset }, color };
+    }
+
+    StaticMesh mesh = LoadStaticMesh(vertices, vertexCount, RL_LINES);
+    MemFree(vertices);
+
+    return mesh;
+}
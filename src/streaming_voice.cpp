@@ -0,0 +1,474 @@
+// Streaming playback of long clips, QOA (qoa.h) or WAV. Only the head of
+// every clip is decoded at load, so playback starts right away, the rest
+// is read from the file while it plays. Output is 16 bit stereo.
+//
+// Main thread decodes into a ring buffer in UpdateStreamingVoice, the
+// mixer takes it from there on the audio thread. The ring is single
+// producer / single consumer like the other queues. When it runs dry,
+// the mixer plays silence instead of waiting.
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/raylib.h"
+
+#include "qoa.h"
+
+const int streamingHeadFrames = 11025;
+// Must be power of two, in stereo frames
+const unsigned int streamingRingFrames = 16384;
+const int streamingReadFrames = 2048;
+// Full QOA frame, of a stereo clip at most
+const int streamingQoaFrameSize = qoaFrameHeaderSize + 2 * (16 + qoaSlicesPerFrame * 8);
+
+struct StreamingClip {
+    FILE* file;
+    long dataOffset;
+    int frameCount;
+
+    int sampleRate;
+    int channels;
+    int bytesPerSample;
+
+    // QOA is decoded a whole frame at a time, the last one is kept
+    bool qoa;
+    short* qoaFrame;
+    int qoaFrameIndex;
+    int qoaFrameSamples;
+
+    // First frames, decoded to 16 bit stereo
+    short* head;
+    int headFrames;
+};
+
+struct StreamingVoice {
+    // Main thread only
+    StreamingClip* clip;
+    int position;
+    bool playing;
+
+    short ring[streamingRingFrames * 2];
+    // In frames. Written only by the main / audio thread respectively
+    std::atomic<unsigned int> head;
+    std::atomic<unsigned int> tail;
+
+    // Set by the main thread when it restarts the voice, the audio
+    // thread then skips everything before this position
+    std::atomic<bool> restart;
+    std::atomic<unsigned int> restartAt;
+    std::atomic<StreamingClip*> restartClip;
+
+    // Audio thread only. The head of a clip is read straight from it, the
+    // ring has only the frames after it. So a restarted voice has sound
+    // while the ring is still full of frames it skips
+    const StreamingClip* headClip;
+    int headCursor;
+
+    // Everything of the clip is in the ring, once
+    // it's empty the clip is over
+    std::atomic<bool> finished;
+};
+
+unsigned int ReadLe(const unsigned char* data, int bytes) {
+    unsigned int value = 0;
+    for(int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// Converts interleaved 16 / 24 bit mono / stereo samples to 16 bit stereo
+void ConvertStreamingFrames(const StreamingClip* clip, const unsigned char* source, short* dest, int frames) {
+    for(int i = 0; i < frames; i++) {
+        for(int c = 0; c < 2; c++) {
+            const unsigned char* sample = source + (i * clip->channels + (c % clip->channels)) * clip->bytesPerSample;
+
+            // Top 16 bits of the sample, 24 bit ones are truncated
+            dest[i * 2 + c] = (short) (sample[clip->bytesPerSample - 2] | (sample[clip->bytesPerSample - 1] << 8));
+        }
+    }
+}
+
+// Copies frames from the QOA frame the position is in, decodes it first
+// when it's not the last decoded one
+int ReadStreamingQoaFrames(StreamingClip* clip, int position, short* dest, int frames) {
+    int frameIndex = position / qoaFrameLength;
+
+    if(frameIndex != clip->qoaFrameIndex) {
+        unsigned char data[streamingQoaFrameSize];
+        long offset = qoaFileHeaderSize + (long) frameIndex * GetQoaFrameSize(clip->channels, qoaFrameLength);
+        if(fseek(clip->file, offset, SEEK_SET) != 0) {
+            return 0;
+        }
+
+        // Last frame is shorter, it's fine to read less
+        int size = (int) fread(data, 1, GetQoaFrameSize(clip->channels, qoaFrameLength), clip->file);
+        if(size < qoaFrameHeaderSize || ReadQoaFrameHeader(data).channels != clip->channels) {
+            return 0;
+        }
+
+        int samples = DecodeQoaFrame(data, size, clip->qoaFrame);
+        if(samples <= 0) {
+            return 0;
+        }
+
+        clip->qoaFrameIndex = frameIndex;
+        clip->qoaFrameSamples = samples;
+    }
+
+    int offset = position - frameIndex * qoaFrameLength;
+    frames = frames < clip->qoaFrameSamples - offset ? frames : clip->qoaFrameSamples - offset;
+
+    for(int i = 0; i < frames; i++) {
+        const short* source = clip->qoaFrame + (offset + i) * clip->channels;
+        dest[i * 2 + 0] = source[0];
+        dest[i * 2 + 1] = source[clip->channels - 1];
+    }
+
+    return frames > 0 ? frames : 0;
+}
+
+// Reads up to the given number of frames from the file at the position
+int ReadStreamingFrames(StreamingClip* clip, int position, short* dest, int frames) {
+    unsigned char buffer[streamingReadFrames * 2 * 3];
+
+    frames = frames < clip->frameCount - position ? frames : clip->frameCount - position;
+    frames = frames < streamingReadFrames ? frames : streamingReadFrames;
+
+    if(clip->qoa && frames > 0) {
+        return ReadStreamingQoaFrames(clip, position, dest, frames);
+    }
+
+    int frameSize = clip->channels * clip->bytesPerSample;
+    if(frames <= 0 || fseek(clip->file, clip->dataOffset + (long) position * frameSize, SEEK_SET) != 0) {
+        return 0;
+    }
+
+    frames = (int) fread(buffer, frameSize, frames, clip->file);
+    ConvertStreamingFrames(clip, buffer, dest, frames);
+
+    return frames;
+}
+
+// File is right after the RIFF header, chunks are
+// walked until the data, fmt comes before it
+bool ParseWavClip(StreamingClip* clip, const char* path) {
+    int format = 0;
+    int bits = 0;
+    bool valid = true;
+    while(valid) {
+        unsigned char chunk[8];
+        if(fread(chunk, 1, 8, clip->file) != 8) {
+            valid = false;
+            break;
+        }
+
+        unsigned int size = ReadLe(chunk + 4, 4);
+
+        if(memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[16];
+            if(size < 16 || fread(fmt, 1, 16, clip->file) != 16) {
+                valid = false;
+                break;
+            }
+
+            format = ReadLe(fmt, 2);
+            clip->channels = ReadLe(fmt + 2, 2);
+            clip->sampleRate = ReadLe(fmt + 4, 4);
+            bits = ReadLe(fmt + 14, 2);
+
+            size -= 16;
+        }
+        else if(memcmp(chunk, "data", 4) == 0) {
+            clip->dataOffset = ftell(clip->file);
+            clip->bytesPerSample = bits / 8;
+
+            int frameSize = clip->channels * clip->bytesPerSample;
+            clip->frameCount = frameSize > 0 ? (int) (size / frameSize) : 0;
+            break;
+        }
+
+        // Chunks are padded to even size
+        if(fseek(clip->file, size + (size & 1), SEEK_CUR) != 0) {
+            valid = false;
+        }
+    }
+
+    // PCM or WAVE_FORMAT_EXTENSIBLE
+    if(valid && ((format != 1 && format != 0xFFFE) || (bits != 16 && bits != 24) ||
+                 clip->channels < 1 || clip->channels > 2 || clip->frameCount == 0)) {
+        printf("%s has to be 16 or 24 bit PCM, mono or stereo\n", path);
+        return false;
+    }
+    else if(valid == false) {
+        printf("%s is not a WAV file\n", path);
+    }
+
+    return valid;
+}
+
+// Only the first frame header is read, the
+// rest is checked when the frames are decoded
+bool ParseQoaClip(StreamingClip* clip, const unsigned char* header) {
+    unsigned char frame[qoaFrameHeaderSize];
+    if(fseek(clip->file, qoaFileHeaderSize, SEEK_SET) != 0 ||
+       fread(frame, 1, qoaFrameHeaderSize, clip->file) != qoaFrameHeaderSize) {
+        return false;
+    }
+
+    QoaFrameHeader frameHeader = ReadQoaFrameHeader(frame);
+
+    clip->qoa = true;
+    clip->frameCount = ReadQoaFileHeader(header);
+    clip->channels = frameHeader.channels;
+    clip->sampleRate = frameHeader.sampleRate;
+    clip->dataOffset = qoaFileHeaderSize;
+    clip->qoaFrameIndex = -1;
+
+    return true;
+}
+
+// Opens the clip and decodes its head, the file stays open
+bool LoadStreamingClip(StreamingClip* clip, const char* path) {
+    memset(clip, 0, sizeof(*clip));
+
+    clip->file = fopen(path, "rb");
+    if(clip->file == NULL) {
+        printf("Failed to open %s\n", path);
+        return false;
+    }
+
+    unsigned char header[12];
+    bool valid = fread(header, 1, 12, clip->file) == 12;
+
+    if(valid && ReadQoaFileHeader(header) >= 0) {
+        valid = ParseQoaClip(clip, header);
+        if(valid && (clip->channels < 1 || clip->channels > 2 || clip->frameCount == 0)) {
+            printf("%s has to be mono or stereo\n", path);
+            valid = false;
+        }
+        else if(valid == false) {
+            printf("%s is not a QOA file\n", path);
+        }
+    }
+    else if(valid && memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0) {
+        valid = ParseWavClip(clip, path);
+    }
+    else {
+        printf("%s is not a QOA or WAV file\n", path);
+        valid = false;
+    }
+
+    if(valid == false) {
+        fclose(clip->file);
+        clip->file = NULL;
+        return false;
+    }
+
+    if(clip->qoa) {
+        clip->qoaFrame = (short*) malloc(qoaFrameLength * clip->channels * sizeof(short));
+    }
+
+    clip->headFrames = streamingHeadFrames < clip->frameCount ? streamingHeadFrames : clip->frameCount;
+    clip->head = (short*) malloc(clip->headFrames * 2 * sizeof(short));
+
+    int decoded = 0;
+    while(decoded < clip->headFrames) {
+        int frames = ReadStreamingFrames(clip, decoded, clip->head + decoded * 2, clip->headFrames - decoded);
+        if(frames == 0) {
+            break;
+        }
+        decoded += frames;
+    }
+    clip->headFrames = decoded;
+
+    return true;
+}
+
+void UnloadStreamingClip(StreamingClip* clip) {
+    if(clip->file) {
+        fclose(clip->file);
+    }
+    free(clip->head);
+    free(clip->qoaFrame);
+    memset(clip, 0, sizeof(*clip));
+}
+
+// Converts frames of the ring from the given position to float
+void CopyStreamingFrames(const StreamingVoice* voice, unsigned int tail, float* output, int frames) {
+    for(int i = 0; i < frames; i++) {
+        unsigned int index = ((tail + i) & (streamingRingFrames - 1)) * 2;
+        output[i * 2 + 0] = voice->ring[index + 0] * (1.0f / 32768);
+        output[i * 2 + 1] = voice->ring[index + 1] * (1.0f / 32768);
+    }
+}
+
+// Audio thread. Converts frames of the head that weren't read yet
+int CopyStreamingHead(const StreamingVoice* voice, float* output, int frames) {
+    if(voice->headClip == NULL) {
+        return 0;
+    }
+
+    int left = voice->headClip->headFrames - voice->headCursor;
+    int count = frames < left ? frames : left;
+
+    const short* head = voice->headClip->head + voice->headCursor * 2;
+    for(int i = 0; i < count * 2; i++) {
+        output[i] = head[i] * (1.0f / 32768);
+    }
+    return count;
+}
+
+// Audio thread. End of the frames in the ring the voice reads. While
+// a restart is pending only the ones before it, the main thread
+// leaves those alone until they're skipped
+unsigned int GetStreamingVoiceHead(StreamingVoice* voice, unsigned int tail) {
+    unsigned int head = voice->head.load(std::memory_order_acquire);
+
+    if(voice->restart.load(std::memory_order_acquire)) {
+        unsigned int restartAt = voice->restartAt.load(std::memory_order_relaxed);
+        head = (int) (restartAt - tail) > 0 ? restartAt : tail;
+    }
+
+    return head;
+}
+
+// Audio thread. Returns the number of frames read, less than asked
+// when the ring ran dry or the clip is over, which sets ended
+int ReadStreamingVoice(StreamingVoice* voice, float* output, int frames, bool* ended) {
+    int count = CopyStreamingHead(voice, output, frames);
+    voice->headCursor += count;
+
+    // Before the head, once it's set, the head has all frames
+    bool finished = voice->finished.load(std::memory_order_acquire);
+    unsigned int tail = voice->tail.load(std::memory_order_relaxed);
+    unsigned int head = GetStreamingVoiceHead(voice, tail);
+
+    unsigned int available = head - tail;
+    int left = frames - count;
+    int read = (unsigned int) left < available ? left : (int) available;
+    CopyStreamingFrames(voice, tail, output + count * 2, read);
+    count += read;
+
+    *ended = finished && count < frames;
+
+    voice->tail.store(tail + read, std::memory_order_release);
+    return count;
+}
+
+// Audio thread. Next frames of the clip that was playing, without
+// taking them. When the voice was restarted, only the old clip's
+int PeekStreamingVoice(StreamingVoice* voice, float* output, int frames) {
+    int count = CopyStreamingHead(voice, output, frames);
+
+    unsigned int tail = voice->tail.load(std::memory_order_relaxed);
+    unsigned int head = GetStreamingVoiceHead(voice, tail);
+
+    unsigned int available = head - tail;
+    int left = frames - count;
+    int read = (unsigned int) left < available ? left : (int) available;
+    CopyStreamingFrames(voice, tail, output + count * 2, read);
+
+    return count + read;
+}
+
+// Audio thread. Takes over the restart of the main thread, called when
+// the mixer voice reading the stream starts. Exchange, so a restart
+// that comes in right now is kept for the next start
+void RestartStreamingVoice(StreamingVoice* voice) {
+    if(voice->restart.exchange(false, std::memory_order_acq_rel) == false) {
+        return;
+    }
+
+    // Tail only moves forward
+    unsigned int tail = voice->tail.load(std::memory_order_relaxed);
+    unsigned int restartAt = voice->restartAt.load(std::memory_order_relaxed);
+    if((int) (restartAt - tail) > 0) {
+        voice->tail.store(restartAt, std::memory_order_release);
+    }
+
+    voice->headClip = voice->restartClip.load(std::memory_order_relaxed);
+    voice->headCursor = 0;
+}
+
+void InitStreamingVoice(StreamingVoice* voice) {
+    voice->clip = NULL;
+    voice->position = 0;
+    voice->playing = false;
+    voice->head = 0;
+    voice->tail = 0;
+    voice->restart = false;
+    voice->restartAt = 0;
+    voice->restartClip = NULL;
+    voice->finished = true;
+    voice->headClip = NULL;
+    voice->headCursor = 0;
+}
+
+// Decodes as much as fits into the ring, called every frame
+void UpdateStreamingVoice(StreamingVoice* voice) {
+    if(voice->playing == false) {
+        return;
+    }
+
+    StreamingClip* clip = voice->clip;
+    unsigned int head = voice->head.load(std::memory_order_relaxed);
+
+    // Frames before a restart are still in the ring until the audio thread
+    // skips them, a restarted clip that was taken over from a playing one
+    // starts to fill the ring only after that. Its head plays meanwhile
+    unsigned int tail = voice->tail.load(std::memory_order_acquire);
+    unsigned int space = streamingRingFrames - (head - tail);
+
+    while(space > 0 && voice->position < clip->frameCount) {
+        // Contiguous part of the ring
+        unsigned int offset = head & (streamingRingFrames - 1);
+        int frames = (int) (space < streamingRingFrames - offset ? space : streamingRingFrames - offset);
+        short* dest = voice->ring + offset * 2;
+
+        frames = ReadStreamingFrames(clip, voice->position, dest, frames);
+        if(frames == 0) {
+            // Read error, end the clip here
+            voice->position = clip->frameCount;
+            break;
+        }
+
+        voice->position += frames;
+        head += frames;
+        space -= frames;
+        voice->head.store(head, std::memory_order_release);
+    }
+
+    // Rest is up to the mixer
+    if(voice->position >= clip->frameCount) {
+        voice->finished.store(true, std::memory_order_release);
+        voice->playing = false;
+    }
+}
+
+// Restarts the voice with the clip, the mixer voice reading
+// from it has to be started after this, which takes it over
+void PlayStreamingVoice(StreamingVoice* voice, StreamingClip* clip) {
+    if(clip->file == NULL) {
+        return;
+    }
+
+    // Head is read from the clip, the ring goes on after it
+    voice->clip = clip;
+    voice->position = clip->headFrames;
+    voice->playing = true;
+
+    // Old frames that weren't played yet are skipped by the audio thread
+    voice->finished.store(false, std::memory_order_relaxed);
+    voice->restartClip.store(clip, std::memory_order_relaxed);
+    voice->restartAt.store(voice->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    voice->restart.store(true, std::memory_order_release);
+
+    UpdateStreamingVoice(voice);
+}
+
+void StopStreamingVoice(StreamingVoice* voice) {
+    voice->playing = false;
+}
@@ -0,0 +1,191 @@
+// Texture atlas, built at load. Sprites and mesh textures are packed
+// into one texture, so the fox billboard and the hand mesh bind the same
+// texture, and adding more sprites doesn't add texture switches.
+//
+// Images are packed into rows, tallest first. Every image gets a border
+// made of copies of its edge pixels, so a filtered lookup at the edge of
+// a region never picks up the neighbouring one.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/raylib.h"
+
+const int maxAtlasRegions = 16;
+const int maxAtlasSize = 4096;
+const int atlasPadding = 2;
+const int atlasNameLength = 64;
+
+struct AtlasRegion {
+    // File name without the directory, meshes refer to their texture by it
+    char name[atlasNameLength];
+
+    // Kept only until the atlas is built
+    Image image;
+
+    // Position in the atlas in pixels, without the border
+    Rectangle rect;
+};
+
+struct TextureAtlas {
+    AtlasRegion regions[maxAtlasRegions];
+    int count;
+
+    Texture2D texture;
+};
+
+// Returns index of the region, or -1 when the image can't be added
+int AddAtlasImage(TextureAtlas* atlas, const char* path) {
+    if(atlas->count == maxAtlasRegions) {
+        printf("Atlas is full, %s not added\n", path);
+        return -1;
+    }
+
+    Image image = LoadImage(path);
+    if(image.data == NULL) {
+        printf("Failed to load atlas image %s\n", path);
+        return -1;
+    }
+
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    AtlasRegion* region = &atlas->regions[atlas->count];
+    memset(region, 0, sizeof(*region));
+    snprintf(region->name, sizeof(region->name), "%s", GetFileName(path));
+    region->image = image;
+
+    return atlas->count++;
+}
+
+// Places regions in rows of the given width, returns the used height
+// or -1 when some image is wider than the atlas
+int PackAtlasRows(TextureAtlas* atlas, const int* order, int width) {
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+
+    for(int i = 0; i < atlas->count; i++) {
+        AtlasRegion* region = &atlas->regions[order[i]];
+        int w = region->image.width + 2 * atlasPadding;
+        int h = region->image.height + 2 * atlasPadding;
+
+        if(w > width) {
+            return -1;
+        }
+
+        if(x + w > width) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+
+        region->rect = { (float) (x + atlasPadding), (float) (y + atlasPadding),
+                         (float) region->image.width, (float) region->image.height };
+
+        x += w;
+        rowHeight = h > rowHeight ? h : rowHeight;
+    }
+
+    return y + rowHeight;
+}
+
+// Copies the image into the atlas, with its edges repeated into the border
+void CopyAtlasImage(Color* pixels, int atlasWidth, const AtlasRegion* region) {
+    const Color* source = (const Color*) region->image.data;
+    int width = region->image.width;
+    int height = region->image.height;
+
+    for(int y = -atlasPadding; y < height + atlasPadding; y++) {
+        int sourceY = y < 0 ? 0 : (y >= height ? height - 1 : y);
+        Color* row = pixels + ((int) region->rect.y + y) * atlasWidth + (int) region->rect.x;
+
+        for(int x = -atlasPadding; x < width + atlasPadding; x++) {
+            int sourceX = x < 0 ? 0 : (x >= width ? width - 1 : x);
+            row[x] = source[sourceY * width + sourceX];
+        }
+    }
+}
+
+// Packs all added images and uploads the atlas texture
+bool BuildAtlas(TextureAtlas* atlas) {
+    // Tallest first, rows waste less space that way
+    int order[maxAtlasRegions];
+    for(int i = 0; i < atlas->count; i++) {
+        int j = i;
+        while(j > 0 && atlas->regions[order[j - 1]].image.height < atlas->regions[i].image.height) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    // Power of two sizes, the narrowest width that keeps it roughly square
+    int width = 64;
+    int height = -1;
+    for(; width <= maxAtlasSize; width *= 2) {
+        int usedHeight = PackAtlasRows(atlas, order, width);
+        if(usedHeight >= 0 && usedHeight <= width) {
+            height = 1;
+            while(height < usedHeight) {
+                height *= 2;
+            }
+            break;
+        }
+    }
+
+    if(height < 0) {
+        printf("Atlas images don't fit into %dx%d\n", maxAtlasSize, maxAtlasSize);
+        return false;
+    }
+
+    Color* pixels = (Color*) calloc(width * height, sizeof(Color));
+    for(int i = 0; i < atlas->count; i++) {
+        CopyAtlasImage(pixels, width, &atlas->regions[i]);
+
+        UnloadImage(atlas->regions[i].image);
+        atlas->regions[i].image = {};
+    }
+
+    Image image = {};
+    image.data = pixels;
+    image.width = width;
+    image.height = height;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+    atlas->texture = LoadTextureFromImage(image);
+    free(pixels);
+
+    return atlas->texture.id != 0;
+}
+
+void UnloadAtlas(TextureAtlas* atlas) {
+    for(int i = 0; i < atlas->count; i++) {
+        UnloadImage(atlas->regions[i].image);
+    }
+
+    UnloadTexture(atlas->texture);
+    memset(atlas, 0, sizeof(*atlas));
+}
+
+// Region with the given file name, or NULL
+const AtlasRegion* FindAtlasRegion(const TextureAtlas* atlas, const char* name) {
+    for(int i = 0; i < atlas->count; i++) {
+        if(strcmp(atlas->regions[i].name, name) == 0) {
+            return &atlas->regions[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Moves a texcoord of the original image into its region. Texcoords
+// have to be in 0..1, repeating textures can't be put into an atlas
+Vector2 GetAtlasTexcoord(const TextureAtlas* atlas, const AtlasRegion* region, Vector2 texcoord) {
+    Vector2 result;
+    result.x = (region->rect.x + texcoord.x * region->rect.width) / atlas->texture.width;
+    result.y = (region->rect.y + texcoord.y * region->rect.height) / atlas->texture.height;
+
+    return result;
+}
@@ -0,0 +1,43 @@
+// Minimal Win32 declarations. windows.h can't be included together
+// with raylib.h, names like Rectangle, CloseWindow or ShowCursor collide.
+
+#pragma once
+
+#if defined(_WIN32)
+
+#include <stddef.h>
+
+struct Win32Point {
+    long x;
+    long y;
+};
+
+#define WIN32_GENERIC_READ 0x80000000
+#define WIN32_FILE_SHARE_READ 0x00000001
+#define WIN32_OPEN_EXISTING 3
+#define WIN32_FILE_ATTRIBUTE_NORMAL 0x00000080
+#define WIN32_PAGE_READONLY 0x02
+#define WIN32_FILE_MAP_READ 0x0004
+#define WIN32_INVALID_HANDLE_VALUE ((void*) (long long) -1)
+
+extern "C" {
+    __declspec(dllimport) int  __stdcall GetCursorPos(Win32Point* point);
+    __declspec(dllimport) int  __stdcall ScreenToClient(void* window, Win32Point* point);
+    __declspec(dllimport) void __stdcall Sleep(unsigned long milliseconds);
+
+    __declspec(dllimport) void* __stdcall CreateFileA(const char* fileName, unsigned long access,
+                                                      unsigned long shareMode, void* securityAttributes,
+                                                      unsigned long creationDisposition,
+                                                      unsigned long flags, void* templateFile);
+    __declspec(dllimport) unsigned long __stdcall GetFileSize(void* file, unsigned long* fileSizeHigh);
+    __declspec(dllimport) void* __stdcall CreateFileMappingA(void* file, void* attributes, unsigned long protect,
+                                                             unsigned long maximumSizeHigh,
+                                                             unsigned long maximumSizeLow, const char* name);
+    __declspec(dllimport) void* __stdcall MapViewOfFile(void* mapping, unsigned long access,
+                                                        unsigned long offsetHigh, unsigned long offsetLow,
+                                                        size_t bytes);
+    __declspec(dllimport) int   __stdcall UnmapViewOfFile(const void* address);
+    __declspec(dllimport) int   __stdcall CloseHandle(void* object);
+}
+
+#endif
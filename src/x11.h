@@ -0,0 +1,20 @@
+// Minimal Xlib declarations. Xlib.h can't be included together
+// with raylib.h, names like Font, Cursor or Status collide.
+
+#pragma once
+
+#if defined(__linux__)
+
+struct X11Display;
+
+typedef unsigned long X11Window;
+
+extern "C" {
+    X11Display* XOpenDisplay(const char* name);
+    int XCloseDisplay(X11Display* display);
+    X11Window XDefaultRootWindow(X11Display* display);
+    int XQueryPointer(X11Display* display, X11Window window, X11Window* root, X11Window* child,
+                      int* rootX, int* rootY, int* windowX, int* windowY, unsigned int* mask);
+}
+
+#endif